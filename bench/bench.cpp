@@ -0,0 +1,439 @@
+// ---------------------------
+// gameboy_bench: コンポーネント単位と全体のベンチマーク
+// ---------------------------
+// 結果はJSONで出力する。--baselineで以前の結果と比べ、閾値（既定5%）を超えて
+// 遅くなった項目を regression として印を付け、終了コード1を返す。
+#include "emulator.hpp"
+#include "farm.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct BenchResult {
+    std::string name;
+    double value = 0.0;
+    std::string unit;
+    bool lowerIsBetter = true;   // ns/op は小さいほど良い、fps 等は大きいほど良い
+
+    // --baseline 指定時
+    bool hasBaseline = false;
+    double baseline = 0.0;
+    double changePercent = 0.0;   // 正なら悪化
+    bool regression = false;
+};
+
+struct BenchOptions {
+    int repeat = 5;                 // 各項目を何回測って最良値を取るか
+    uint64_t frames = 600;          // 全体ベンチで各ROMを回すフレーム数
+    std::string romDir = "roms";
+    std::string filter;             // 名前にこの文字列を含む項目だけ
+    bool quick = false;             // 反復回数を減らす（動作確認用）
+};
+
+double seconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// 計測した値を使ったことにして、計算ごと最適化で消されないようにする
+void doNotOptimize(uint32_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r"(value) : "memory");
+#else
+    static volatile uint32_t sink;
+    sink = value;
+    (void)sink;
+#endif
+}
+
+// 1回の計測（戻り値: 1操作あたりのナノ秒）を repeat 回行い、最良値を返す
+double bestOf(int repeat, const std::function<double()>& measure) {
+    double best = 0.0;
+    for (int i = 0; i < repeat; ++i) {
+        const double v = measure();
+        if (i == 0 || v < best) best = v;
+    }
+    return best;
+}
+
+std::vector<uint8_t> readFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+// ---------------------------
+// CPU::step（命令の種類別）
+// ---------------------------
+// 同じ種類の命令を並べたブロックを無限ループさせる合成ROMを作り、CPU::stepだけを回す。
+struct OpcodeClass {
+    const char* name;
+    std::vector<uint8_t> pattern;   // 繰り返す命令列
+    int instructions;               // pattern に含まれる命令数
+};
+
+std::vector<OpcodeClass> opcodeClasses() {
+    return {
+        {"nop",        {0x00}, 1},
+        {"ld_r_r",     {0x41, 0x5A, 0x63, 0x7C}, 4},                   // LD B,C / LD E,D / LD H,E / LD A,H
+        {"ld_r_imm",   {0x06, 0x12, 0x1E, 0x34}, 2},                   // LD B,n / LD E,n
+        {"alu_r",      {0x80, 0x91, 0xA2, 0xB3, 0x88, 0xAF}, 6},       // ADD/SUB/AND/OR/ADC/XOR
+        {"alu_imm",    {0xC6, 0x01, 0xD6, 0x01, 0xE6, 0xFF}, 3},       // ADD/SUB/AND n
+        {"inc_dec_r",  {0x04, 0x0D, 0x14, 0x1D}, 4},
+        {"alu_16bit",  {0x03, 0x09, 0x1B, 0x39}, 4},                   // INC BC / ADD HL,BC / DEC DE / ADD HL,SP
+        {"load_hl",    {0x7E, 0x77, 0x46, 0x70}, 4},                   // (HL)=WRAM の読み書き
+        {"ldh_hram",   {0xF0, 0x80, 0xE0, 0x81}, 2},
+        {"ldh_io",     {0xF0, 0x44, 0xF0, 0x41}, 2},                   // LY/STAT（同期が入る）
+        {"push_pop",   {0xC5, 0xD1, 0xE5, 0xF1}, 4},
+        {"jr",         {0x18, 0x00}, 1},
+        {"call_ret",   {0xCD, 0x50, 0x01}, 2},                         // 0x0150 の RET を呼ぶ
+        {"cb_ops",     {0xCB, 0x40, 0xCB, 0x11, 0xCB, 0x37, 0xCB, 0xC0}, 4},  // BIT/RL/SWAP/SET
+    };
+}
+
+std::vector<uint8_t> makeOpcodeROM(const OpcodeClass& cls, int* blockInstructions) {
+    std::vector<uint8_t> rom(0x8000, 0x00);
+    const uint8_t entry[] = {0xC3, 0x00, 0x02};                  // 0x0100: JP 0x0200
+    std::copy(std::begin(entry), std::end(entry), rom.begin() + 0x100);
+    rom[0x150] = 0xC9;                                           // 0x0150: RET
+    const uint8_t setup[] = {0x31, 0xFE, 0xDF,                   // LD SP,DFFE
+                             0x21, 0x00, 0xC0};                  // LD HL,C000
+    size_t pc = 0x200;
+    for (uint8_t b : setup) rom[pc++] = b;
+    const size_t loop = pc;
+    int count = 0;
+    while (pc + cls.pattern.size() + 3 < 0x4000) {
+        std::copy(cls.pattern.begin(), cls.pattern.end(), rom.begin() + pc);
+        pc += cls.pattern.size();
+        count += cls.instructions;
+    }
+    rom[pc++] = 0xC3;                                            // JP loop
+    rom[pc++] = static_cast<uint8_t>(loop & 0xFF);
+    rom[pc++] = static_cast<uint8_t>(loop >> 8);
+    *blockInstructions = count + 1;
+    return rom;
+}
+
+void benchCPU(const BenchOptions& options, std::vector<BenchResult>& results) {
+    const int steps = options.quick ? 200000 : 4000000;
+    for (const OpcodeClass& cls : opcodeClasses()) {
+        const std::string name = std::string("cpu_step/") + cls.name;
+        if (name.find(options.filter) == std::string::npos) continue;
+
+        int blockInstructions = 0;
+        const std::vector<uint8_t> rom = makeOpcodeROM(cls, &blockInstructions);
+        auto emu = std::make_unique<Emulator>();
+        emu->loadROMData(rom.data(), rom.size());
+        CPU& cpu = emu->getCPU();
+        for (int i = 0; i < 16; ++i) cpu.step();   // セットアップ部分を抜ける
+
+        const double ns = bestOf(options.repeat, [&] {
+            const auto start = Clock::now();
+            for (int i = 0; i < steps; ++i) {
+                cpu.step();
+            }
+            return seconds(start) * 1e9 / steps;
+        });
+        results.push_back({name, ns, "ns/op", true});
+    }
+}
+
+// ---------------------------
+// Memory::readByte / writeByte（領域別）
+// ---------------------------
+struct Region {
+    const char* name;
+    uint16_t begin;
+    uint16_t end;   // 含まない
+};
+
+void benchMemory(const BenchOptions& options, std::vector<BenchResult>& results) {
+    const std::vector<Region> readRegions = {
+        {"rom0", 0x0000, 0x4000}, {"romx", 0x4000, 0x8000}, {"vram", 0x8000, 0xA000},
+        {"wram", 0xC000, 0xE000}, {"echo", 0xE000, 0xFE00}, {"oam", 0xFE00, 0xFEA0},
+        {"io", 0xFF00, 0xFF80}, {"hram", 0xFF80, 0xFFFF},
+    };
+    // 書き込みは副作用のないレジスタだけ（DMA/DIV/LCDC等は除く）
+    const std::vector<Region> writeRegions = {
+        {"vram", 0x8000, 0xA000}, {"wram", 0xC000, 0xE000}, {"echo", 0xE000, 0xFE00},
+        {"oam", 0xFE00, 0xFEA0}, {"io", 0xFF42, 0xFF44}, {"hram", 0xFF80, 0xFFFF},
+    };
+    const int accesses = options.quick ? 200000 : 4000000;
+
+    auto emu = std::make_unique<Emulator>();
+    const std::vector<uint8_t> rom(0x8000, 0x00);
+    emu->loadROMData(rom.data(), rom.size());
+    Memory& memory = emu->getMemory();
+
+    for (int write = 0; write < 2; ++write) {
+        for (const Region& region : write ? writeRegions : readRegions) {
+            const std::string name = std::string(write ? "memory_write/" : "memory_read/") + region.name;
+            if (name.find(options.filter) == std::string::npos) continue;
+
+            const int span = region.end - region.begin;
+            const double ns = bestOf(options.repeat, [&] {
+                uint32_t sink = 0;
+                const auto start = Clock::now();
+                for (int i = 0; i < accesses; ++i) {
+                    const uint16_t addr = static_cast<uint16_t>(region.begin + (i % span));
+                    if (write) {
+                        memory.writeByte(addr, static_cast<uint8_t>(i));
+                    } else {
+                        sink += memory.readByte(addr);
+                    }
+                }
+                const double elapsed = seconds(start);
+                doNotOptimize(sink);
+                return elapsed * 1e9 / accesses;
+            });
+            results.push_back({name, ns, "ns/op", true});
+        }
+    }
+}
+
+// ---------------------------
+// PPU::step（モード別）/ Timer::step
+// ---------------------------
+// 実ROMを少し進めて画面が出ている状態にし、スケジューラと同じくイベント単位の塊で進める。
+void benchPPU(const BenchOptions& options, std::vector<BenchResult>& results) {
+    const char* modeNames[4] = {"hblank", "vblank", "oam_scan", "transfer"};
+    const std::string romPath = options.romDir + "/dmg-acid2.gb";
+    std::vector<uint8_t> rom = readFile(romPath);
+    if (rom.empty()) {
+        std::cerr << "[bench] PPU: " << romPath << " not found, skipped" << std::endl;
+        return;
+    }
+    const uint64_t frames = options.quick ? 20 : 300;
+
+    double best[4] = {0, 0, 0, 0};
+    for (int rep = 0; rep < options.repeat; ++rep) {
+        auto emu = std::make_unique<Emulator>();
+        emu->loadROMData(rom.data(), rom.size());
+        for (int i = 0; i < 60; ++i) emu->runFrame();
+        PPU& ppu = emu->getPPU();
+        Memory& memory = emu->getMemory();
+
+        double elapsed[4] = {0, 0, 0, 0};
+        uint64_t cycles[4] = {0, 0, 0, 0};
+        uint64_t remaining = frames * Emulator::FRAME_CYCLES;
+        while (remaining > 0) {
+            const int mode = memory.STAT & 0x03;
+            int chunk = ppu.cyclesUntilEvent();
+            if (chunk <= 0) chunk = 4;
+            chunk = static_cast<int>(std::min<uint64_t>(chunk, remaining));
+            const auto start = Clock::now();
+            ppu.step(chunk);
+            elapsed[mode] += seconds(start);
+            cycles[mode] += chunk;
+            remaining -= chunk;
+        }
+        for (int m = 0; m < 4; ++m) {
+            const double ns = cycles[m] ? elapsed[m] * 1e9 / cycles[m] : 0.0;
+            if (rep == 0 || ns < best[m]) best[m] = ns;
+        }
+    }
+    for (int m = 0; m < 4; ++m) {
+        const std::string name = std::string("ppu_step/") + modeNames[m];
+        if (name.find(options.filter) == std::string::npos) continue;
+        results.push_back({name, best[m], "ns/cycle", true});
+    }
+}
+
+void benchTimer(const BenchOptions& options, std::vector<BenchResult>& results) {
+    const int calls = options.quick ? 200000 : 4000000;
+    for (int chunk : {4, 456}) {
+        const std::string name = "timer_step/chunk" + std::to_string(chunk);
+        if (name.find(options.filter) == std::string::npos) continue;
+
+        auto emu = std::make_unique<Emulator>();
+        const std::vector<uint8_t> rom(0x8000, 0x00);
+        emu->loadROMData(rom.data(), rom.size());
+        emu->writeByte(0xFF07, 0x05);   // TAC: 有効, 16サイクル周期（オーバーフローも頻繁に起きる）
+        Timer& timer = emu->getTimer();
+
+        const double ns = bestOf(options.repeat, [&] {
+            const auto start = Clock::now();
+            for (int i = 0; i < calls; ++i) {
+                timer.step(chunk);
+            }
+            return seconds(start) * 1e9 / calls;
+        });
+        results.push_back({name, ns, "ns/op", true});
+    }
+}
+
+// ---------------------------
+// 全体: roms/ の各ROMをフレーム単位で回す
+// ---------------------------
+void benchSystem(const BenchOptions& options, std::vector<BenchResult>& results) {
+    const uint64_t frames = options.quick ? 60 : options.frames;
+    for (const std::string& romPath : collectROMs({options.romDir})) {
+        const std::string name = "system_fps/" + std::filesystem::path(romPath).stem().string();
+        if (name.find(options.filter) == std::string::npos) continue;
+
+        const std::vector<uint8_t> rom = readFile(romPath);
+        // fpsは大きいほど良いので、最良値は最小のフレーム時間から求める
+        const double secondsPerFrame = bestOf(options.repeat, [&] {
+            auto emu = std::make_unique<Emulator>();
+            emu->loadROMData(rom.data(), rom.size());
+            const auto start = Clock::now();
+            for (uint64_t i = 0; i < frames; ++i) {
+                emu->runFrame();
+            }
+            return seconds(start) / frames;
+        });
+        results.push_back({name, secondsPerFrame > 0 ? 1.0 / secondsPerFrame : 0.0, "fps", false});
+    }
+}
+
+// ---------------------------
+// 比較と出力
+// ---------------------------
+// 自分が書いたJSONだけを読めればよいので、"name"と"value"の組を順に拾う
+std::map<std::string, double> readBaseline(const std::string& path) {
+    std::map<std::string, double> values;
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "[bench] Failed to open baseline: " << path << std::endl;
+        return values;
+    }
+    const std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    size_t pos = 0;
+    while ((pos = text.find("\"name\":\"", pos)) != std::string::npos) {
+        pos += 8;
+        const size_t nameEnd = text.find('"', pos);
+        const size_t valuePos = text.find("\"value\":", nameEnd);
+        if (nameEnd == std::string::npos || valuePos == std::string::npos) break;
+        values[text.substr(pos, nameEnd - pos)] = std::strtod(text.c_str() + valuePos + 8, nullptr);
+        pos = valuePos;
+    }
+    return values;
+}
+
+int compareBaseline(std::vector<BenchResult>& results, const std::map<std::string, double>& baseline,
+                    double thresholdPercent) {
+    int regressions = 0;
+    for (BenchResult& r : results) {
+        auto it = baseline.find(r.name);
+        if (it == baseline.end() || it->second <= 0.0 || r.value <= 0.0) continue;
+        r.hasBaseline = true;
+        r.baseline = it->second;
+        // 悪化を正にそろえる（ns/opは増加、fpsは減少が悪化）
+        r.changePercent = r.lowerIsBetter ? (r.value / r.baseline - 1.0) * 100.0
+                                          : (r.baseline / r.value - 1.0) * 100.0;
+        r.regression = r.changePercent > thresholdPercent;
+        if (r.regression) {
+            ++regressions;
+            std::cerr << "[bench] REGRESSION " << r.name << ": " << r.baseline << " -> " << r.value
+                      << " " << r.unit << " (" << r.changePercent << "% worse)" << std::endl;
+        }
+    }
+    return regressions;
+}
+
+void writeJSON(std::ostream& out, const std::vector<BenchResult>& results, const BenchOptions& options,
+               bool compared, double thresholdPercent, int regressions) {
+    out << "{\"repeat\":" << options.repeat
+        << ",\"quick\":" << (options.quick ? "true" : "false")
+        << ",\"benchmarks\":[";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        out << (i ? "," : "") << "\n  {\"name\":\"" << escapeJSON(r.name) << "\""
+            << ",\"value\":" << r.value
+            << ",\"unit\":\"" << r.unit << "\""
+            << ",\"lower_is_better\":" << (r.lowerIsBetter ? "true" : "false");
+        if (r.hasBaseline) {
+            out << ",\"baseline\":" << r.baseline
+                << ",\"change_percent\":" << r.changePercent
+                << ",\"regression\":" << (r.regression ? "true" : "false");
+        }
+        out << "}";
+    }
+    out << "\n]";
+    if (compared) {
+        out << ",\"threshold_percent\":" << thresholdPercent << ",\"regressions\":" << regressions;
+    }
+    out << "}\n";
+}
+
+void printUsage(const char* prog) {
+    std::cout << "Usage: " << prog << " [options]\n"
+              << "  --filter STR       名前にSTRを含む項目だけ実行（例: cpu_step, system_fps/cpu_instrs）\n"
+              << "  --repeat N         各項目をN回測って最良値を採る（既定5）\n"
+              << "  --frames N         全体ベンチで各ROMを回すフレーム数（既定600）\n"
+              << "  --roms DIR         ROMディレクトリ（既定: roms）\n"
+              << "  --quick            反復を減らした短時間モード（動作確認用）\n"
+              << "  --json PATH        結果をファイルへ（既定: 標準出力）\n"
+              << "  --baseline PATH    以前の結果と比べ、閾値を超えた悪化をregressionとする（終了コード1）\n"
+              << "  --threshold PCT    悪化の閾値（%、既定5）\n";
+}
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    std::string jsonPath;
+    std::string baselinePath;
+    double thresholdPercent = 5.0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg == "--filter" && hasValue) {
+            options.filter = argv[++i];
+        } else if (arg == "--repeat" && hasValue) {
+            options.repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--frames" && hasValue) {
+            options.frames = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--roms" && hasValue) {
+            options.romDir = argv[++i];
+        } else if (arg == "--quick") {
+            options.quick = true;
+        } else if (arg == "--json" && hasValue) {
+            jsonPath = argv[++i];
+        } else if (arg == "--baseline" && hasValue) {
+            baselinePath = argv[++i];
+        } else if (arg == "--threshold" && hasValue) {
+            thresholdPercent = std::atof(argv[++i]);
+        } else {
+            std::cerr << "Unknown option: " << arg << "\n";
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<BenchResult> results;
+    benchCPU(options, results);
+    benchMemory(options, results);
+    benchPPU(options, results);
+    benchTimer(options, results);
+    benchSystem(options, results);
+
+    int regressions = 0;
+    const bool compared = !baselinePath.empty();
+    if (compared) {
+        regressions = compareBaseline(results, readBaseline(baselinePath), thresholdPercent);
+    }
+
+    if (!jsonPath.empty()) {
+        std::ofstream json(jsonPath);
+        writeJSON(json, results, options, compared, thresholdPercent, regressions);
+    } else {
+        writeJSON(std::cout, results, options, compared, thresholdPercent, regressions);
+    }
+    return regressions > 0 ? 1 : 0;
+}
@@ -1,8 +1,13 @@
 #pragma once
 #include <cstdint>
+#include <ostream>
 #include "memory.hpp"
 #include "ppu.hpp"
 
+class StateReader;
+class StateWriter;
+class TimelineRecorder;
+
 // ---------------------------
 // Fレジスタ用ビットマスク定義
 // ---------------------------
@@ -16,10 +21,24 @@ public:
     CPU(Memory* mem, PPU* ppu);
     void reset();      // CPUを初期化する
     int step();       // 1命令を実行する
+    bool isHalted() const { return halted; }
+    uint16_t getPC() const { return PC; }
+    bool getIME() const { return ime; }
+
+    // 命令トレース出力先（nullptrで無効。既定は無効）
+    void setTraceOutput(std::ostream* out) { trace.rdbuf(out ? out->rdbuf() : nullptr); }
+    // タイムライン記録（割り込みの受付）
+    void setTimeline(TimelineRecorder* recorder) { timeline = recorder; }
+
+    // セーブステート（savestate.hpp）
+    void saveState(StateWriter& out) const;
+    void loadState(StateReader& in);
 
 private:
     Memory* memory;
     PPU* ppu;
+    std::ostream trace{nullptr};  // 無効時はbadbitが立ち、書式化もほぼ素通りになる
+    TimelineRecorder* timeline = nullptr;
 
     // レジスタ
     uint8_t A, F;      // A: アキュムレータ, F: フラグ
@@ -3,6 +3,8 @@
 #include <cstdint>
 
 class Input;  // 前方宣言
+class Profiler;
+class TimelineRecorder;
 
 class Display {
 public:
@@ -10,17 +12,33 @@ public:
     ~Display();
 
     bool init();
-    void updateFrame(const uint32_t* framebuffer);
+    // pixels: ARGB8888に変換済みのフレーム（pitch: 1行あたりのバイト数。PPUのFrameTargetの出力先など）
+    // lineHashes: 各行のハッシュ（渡された場合は前回転送時から変化した行だけ転送する）
+    void updateFrame(const void* pixels, int pitch, const uint64_t* lineHashes = nullptr);
     bool handleEvents(Input* input = nullptr); // false if quit requested
+    bool isRewindHeld() const { return rewindHeld; }  // 巻き戻しキー（Backspace）を押しているか
+    bool isTurboHeld() const { return turboHeld; }    // ターボキー（Tab）を押しているか
     void close();
+    void setProfiler(Profiler* p) { profiler = p; }  // updateFrameをDisplay区間に数える
+    void setTimeline(TimelineRecorder* recorder) { timeline = recorder; }  // 表示をホスト側に記録
 
 private:
     SDL_Window* window = nullptr;
     SDL_Renderer* renderer = nullptr;
     SDL_Texture* texture = nullptr;
+    Profiler* profiler = nullptr;
+    TimelineRecorder* timeline = nullptr;
+    bool sdlInitialized = false;  // init()でSDLを初期化したか（未使用のDisplayはSDLに触れない）
 
     static constexpr int WINDOW_WIDTH = 160 * 3;  // 3倍拡大
     static constexpr int WINDOW_HEIGHT = 144 * 3; // 3倍拡大
     static constexpr int GB_WIDTH = 160;
     static constexpr int GB_HEIGHT = 144;
+
+    uint64_t uploadedHashes[GB_HEIGHT]{};  // テクスチャに転送済みの各行のハッシュ
+    bool textureValid = false;             // uploadedHashes が有効か
+    bool rewindHeld = false;
+    bool turboHeld = false;
+
+    void uploadRows(const uint8_t* pixels, int pitch, int firstRow, int rowCount);
 };
\ No newline at end of file
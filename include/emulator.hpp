@@ -1,19 +1,120 @@
 #pragma once
 #include <string>
+#include <vector>
+#include <ostream>
+#include <functional>
 #include "cpu.hpp"
 #include "memory.hpp"
 #include "ppu.hpp"
+#include "profiler.hpp"
 #include "input.hpp"
 #include "timer.hpp"
-#include "display.hpp"
+#include "serial.hpp"
+#include "scheduler.hpp"
+#include "timeline.hpp"
+
+// ヘッドレス実行の終了条件（0/空は無制限）
+struct RunOptions {
+    uint64_t maxFrames = 0;
+    uint64_t maxCycles = 0;
+    std::vector<std::string> exitOnSerial;   // シリアル出力がこの文字列で終わったら終了
+    bool exitOnLoop = false;                 // 抜け出せない無限ループ/HALTで終了
+    std::vector<uint64_t> exitOnFrameHash;   // フレーム境界で画面ハッシュがいずれかに一致したら終了
+    std::string saveFramePath;               // 終了時にPPMで保存（空なら保存しない）
+};
+
+// ヘッドレス実行の結果と計測値
+struct RunResult {
+    std::string exitReason;
+    uint64_t cycles = 0;
+    uint64_t frames = 0;
+    uint64_t instructions = 0;
+    double wallSeconds = 0.0;
+    uint64_t frameHash = 0;
+    std::string serialOutput;
+
+    void writeJSON(std::ostream& out) const;  // JSONオブジェクト1つを出力（改行なし）
+};
+
+std::string escapeJSON(const std::string& text);  // JSON文字列リテラル用のエスケープ
 
 class Emulator {
 public:
+    static constexpr uint64_t FRAME_CYCLES = 70224;  // 1フレーム分のサイクル数
+
     Emulator();
-    void loadROM(const std::string& path);
+    bool loadROM(const std::string& path);  // 失敗したらfalse
+    bool loadROMData(const uint8_t* data, size_t size);  // メモリ上のROMイメージから
     uint8_t readByte(uint16_t addr) const { return memory.readByte(addr); }
-    void run();
-    void runWithDisplay(); // SDL2ウィンドウ付き実行
+    void writeByte(uint16_t addr, uint8_t val) { memory.writeByte(addr, val); }
+    RunResult run(const RunOptions& options = {});  // 終了条件まで実行して計測値を返す
+
+    // フロントエンド/組み込み用の実行単位
+    void runFrame();                    // 次のフレーム境界（70224サイクル間隔）まで進める
+    void runCycles(uint64_t cycles);    // 指定サイクル以上進める（命令境界で止まる）
+
+    void setTraceOutput(std::ostream* out) { cpu.setTraceOutput(out); }  // 命令トレース
+
+    // シリアル送信バイトの受け取り先（run()の出力収集とは別に呼ばれる）
+    void setSerialSink(std::function<void(uint8_t)> sink) { serialSink = std::move(sink); }
+    const std::string& getSerialOutput() const { return serialOutput; }  // ROMロードからの全出力
+
+    // セーブステート（同じROMを読み込んだインスタンス間でビット単位に再開できる）
+    // 保存前に全コンポーネントを同期するので、同じ時刻の状態は同期の履歴によらず同じバイト列になる
+    void saveState(std::vector<uint8_t>& out);               // outは上書き（容量は再利用）
+    bool loadState(const uint8_t* data, size_t size);       // 失敗時は状態を変えずにfalse
+    bool saveStateFile(const std::string& path);
+    bool loadStateFile(const std::string& path);
+    // 同じROMを読み込んだ別インスタンスと同一にする（stateはsource.saveState()の結果）
+    // フレームの区切りも写すので、以後は同じ入力でsourceとビット単位で同じ経過をたどる
+    bool cloneState(const Emulator& source, const std::vector<uint8_t>& state);
+    // 同じインスタンスへ戻すための一時スナップショット（先読み実行など）
+    // ロールバック用の控えを取らず、runFrame()の区切りも含めて保存した時点へ正確に戻す
+    void saveSnapshot(std::vector<uint8_t>& out);
+    bool restoreSnapshot(const std::vector<uint8_t>& snapshot);
+
+    // ジョイパッド（Input::getButtonMask()形式）と、同期確認用の状態ハッシュ
+    uint8_t getButtonMask() const { return input.getButtonMask(); }
+    void setButtonMask(uint8_t mask) { input.setButtonMask(mask); }
+    Input& getInput() { return input; }
+    uint64_t getStateHash();  // ゲームの進行に関わる状態のハッシュ（描画結果は含まない）
+    uint64_t getROMHash() const { return memory.getROMHash(); }
+
+    // 64bitマスタークロック（ROMロードからの経過Tサイクル数）
+    uint64_t getCycleCount() const { return scheduler.now(); }
+    // このインスタンスで実行した命令数（HALT中の読み飛ばしは1回と数える。状態には含まない）
+    uint64_t getInstructionCount() const { return instructionCount; }
+
+    // 描画モード（フレーム間引き/描画オフ）。ゲームロジックには影響しない
+    void setRenderMode(PPU::RenderMode mode, int interval = 1) { ppu.setRenderMode(mode, interval); }
+    PPU::RenderMode getRenderMode() const { return ppu.getRenderMode(); }
+    int getRenderInterval() const { return ppu.getRenderInterval(); }
+
+    // 観測用: 詰めたシェードフレームそのもの / 指定形式への変換コピー
+    const uint8_t* getFrameBuffer() const { return ppu.getFrameBuffer(); }
+    void copyFrame(void* dst, int pitch, PixelFormat fmt) const { ppu.convertFrame(dst, pitch, fmt); }
+    // 描画したラインを呼び出し側のメモリへ直接書き込ませる（PPU::setFrameTarget）
+    void setFrameTarget(const FrameTarget& target) { ppu.setFrameTarget(target); }
+    uint64_t getFrameHash() const { return ppu.getFrameHash(); }
+    const uint64_t* getLineHashes() const { return ppu.getLineHashes(); }
+    const std::bitset<SCREEN_HEIGHT>& getDirtyLines() const { return ppu.getDirtyLines(); }
+    const uint8_t* getWRAM() const { return memory.getWRAM(); }  // 0xC000-0xDFFF
+    const uint8_t* getHRAM() const { return memory.getHRAM(); }  // 0xFF80-0xFFFE
+
+    // サブシステム別の時間計測（GAMEBOY_PROFILEでビルドしたときだけ有効。無効ならenabled=false）
+    ProfileStats getProfileStats() const;
+    void resetProfile();
+    Profiler* getProfiler();  // 無効ならnullptr（フロントエンドが表示処理を同じ計測器に数える用）
+
+    // タイムライン記録（nullptrで無効。記録器は呼び出し側が持ち、終了時に書き出す）
+    void setTimeline(TimelineRecorder* recorder);
+    TimelineRecorder* getTimeline() const { return timeline; }
+
+    // ベンチマーク用: コンポーネントを単独で回す（通常の実行と混ぜないこと）
+    CPU& getCPU() { return cpu; }
+    Memory& getMemory() { return memory; }
+    PPU& getPPU() { return ppu; }
+    Timer& getTimer() { return timer; }
 
 private:
     Memory memory;
@@ -21,5 +122,28 @@ private:
     PPU ppu;
     Input input;
     Timer timer;
-    Display display;
+    Serial serial;
+    Scheduler scheduler;
+
+    std::string serialOutput;
+    SerialMatcher serialMatcher;     // 終了パターンの逐次照合
+    int serialMatch = -1;            // 一致したパターン番号（-1: まだ）
+    std::function<void(uint8_t)> serialSink;
+    uint64_t nextFrameCycle = FRAME_CYCLES;  // runFrame()の次の境界
+    uint64_t instructionCount = 0;
+    std::vector<uint8_t> hashScratch;
+    TimelineRecorder* timeline = nullptr;
+    uint64_t haltStart = Scheduler::NEVER;  // タイムライン記録中のHALT開始時刻
+#ifdef GAMEBOY_PROFILE
+    Profiler profiler;
+#endif
+
+    void reset();
+    void onSerialByte(uint8_t byte);
+    bool applyState(const uint8_t* data, size_t size);
+
+    void runUntil(uint64_t targetCycle);
+    int stepInstruction();  // 1命令（HALT中は次のイベントまで）進めて消費サイクルを返す
+    bool isStuck(uint16_t pcBefore) const;
+    void pollProfileDump();  // SIGUSR1を受けていれば統計を標準エラーへ出す
 };
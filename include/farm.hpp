@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "emulator.hpp"
+
+// ---------------------------
+// ROMテストファーム
+// ---------------------------
+// 1ROM=1タスクとして複数のEmulatorをスレッドプール上で同時に走らせ、
+// 結果を1つのレポート（JSON / JUnit XML）にまとめる。
+
+struct FarmJob {
+    std::string romPath;
+    RunOptions options;                                  // タスクごとのサイクル予算など
+    PPU::RenderMode renderMode = PPU::RenderMode::Full;
+    int renderInterval = 1;
+};
+
+struct FarmResult {
+    std::string romPath;
+    std::string status;   // "passed" / "failed" / "no_result" / "error"
+    RunResult run;
+};
+
+struct FarmReport {
+    std::vector<FarmResult> results;   // ジョブと同じ順序
+    size_t threads = 0;
+    double wallSeconds = 0.0;
+
+    size_t count(const std::string& status) const;
+    bool allPassed() const { return count("passed") == results.size(); }
+    void writeJSON(std::ostream& out) const;   // 1行のJSON
+    void writeJUnit(std::ostream& out) const;  // JUnit XML
+};
+
+// ディレクトリは中の *.gb に展開する（名前順）
+std::vector<std::string> collectROMs(const std::vector<std::string>& paths);
+
+FarmReport runFarm(const std::vector<FarmJob>& jobs, size_t threads);
@@ -0,0 +1,55 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+// ---------------------------
+// フレームペーシング（実機の59.7275Hzに合わせる）
+// ---------------------------
+// 期限の少し手前まではスリープし、残りはスピンして高精度に待つ。
+// 期限は前回の期限に周期を足して決める（誤差を溜めない）。大きく遅れたら今から数え直す。
+class FramePacer {
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr double GB_FRAME_RATE = 4194304.0 / 70224.0;  // 約59.7275Hz
+
+    // フレーム時間の統計（直近 HISTORY フレーム、ミリ秒）
+    struct Stats {
+        size_t frames = 0;
+        double fps = 0.0;
+        double meanMs = 0.0;
+        double p50Ms = 0.0;
+        double p90Ms = 0.0;
+        double p99Ms = 0.0;
+        double maxMs = 0.0;
+        double jitterP50Ms = 0.0;   // 目標フレーム時間とのずれ（制限中のフレームのみ）
+        double jitterP99Ms = 0.0;
+    };
+
+    explicit FramePacer(double speed = 1.0);
+
+    void setSpeed(double multiplier) { speed = multiplier; }   // 0以下で無制限
+    double getSpeed() const { return speed; }
+    void setTurbo(bool on) { turbo = on; }                     // 有効な間は無制限
+    bool isUncapped() const { return turbo || speed <= 0.0; }
+
+    void waitForNextFrame();   // 次のフレーム時刻まで待ち、フレーム時間を記録する
+    void reset();
+    Stats getStats() const;
+
+private:
+    static constexpr size_t HISTORY = 1200;
+
+    double speed;
+    bool turbo = false;
+    bool started = false;
+    Clock::time_point deadline;
+    Clock::time_point lastFrame;
+
+    std::vector<double> frameTimes;   // リングバッファ（ミリ秒）
+    std::vector<double> jitters;
+    size_t frameIndex = 0;
+    size_t jitterIndex = 0;
+
+    Clock::duration period() const;
+};
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// ---------------------------
+// 画面サイズ・フレームバッファ形式
+// ---------------------------
+// PPUは色(ARGB)ではなく2bitのシェード番号(0=白..3=黒)を保持する。
+// 1バイトに4ピクセル（x&3 番目を下位ビットから2bitずつ）詰めるので
+// 1ライン=40バイト、1フレーム=5760バイト。
+constexpr int SCREEN_WIDTH      = 160;
+constexpr int SCREEN_HEIGHT     = 144;
+constexpr int FRAME_LINE_BYTES  = SCREEN_WIDTH / 4;
+constexpr int FRAME_BYTES       = FRAME_LINE_BYTES * SCREEN_HEIGHT;
+
+// 変換先のピクセル形式
+enum class PixelFormat {
+    ARGB8888,   // 32bit (SDL_PIXELFORMAT_ARGB8888)
+    RGB565,     // 16bit
+    Gray8       // 8bit グレースケール
+};
+
+inline uint8_t getShade(const uint8_t* frame, int x, int y) {
+    const uint8_t b = frame[y * FRAME_LINE_BYTES + (x >> 2)];
+    return (b >> ((x & 3) * 2)) & 0x03;
+}
+
+inline void setShade(uint8_t* frame, int x, int y, uint8_t shade) {
+    uint8_t& b = frame[y * FRAME_LINE_BYTES + (x >> 2)];
+    const int shift = (x & 3) * 2;
+    b = static_cast<uint8_t>((b & ~(0x03 << shift)) | ((shade & 0x03) << shift));
+}
+
+int bytesPerPixel(PixelFormat fmt);
+
+// 1ライン(40バイト)の64bitハッシュ。差分検出・フレーム比較用（実行環境に依存しない値）
+uint64_t hashFrameLine(const uint8_t* packedLine);
+
+// ラインハッシュ列(144本)からフレームハッシュを合成する
+uint64_t combineLineHashes(const uint64_t* lineHashes);
+
+// 1ライン(40バイト)を変換して dst に160ピクセル書き込む
+void convertFrameLine(const uint8_t* packedLine, void* dst, PixelFormat fmt);
+
+// フレーム全体を変換（pitch: 出力1行あたりのバイト数。0なら詰めて書く）
+void convertFrame(const uint8_t* frame, void* dst, int pitch, PixelFormat fmt);
+
+// PPUが描き終えたラインを変換して直接書き込む先（呼び出し側のメモリ: テクスチャのロック先や転送用バッファ）
+// lineHashes を渡すと各行に入っている内容のハッシュをそこに記録し、同じ内容の行は書き直さない
+struct FrameTarget {
+    void* pixels = nullptr;          // nullptrなら書き込まない
+    int pitch = 0;                   // 出力1行あたりのバイト数（0なら詰めて書く）
+    PixelFormat format = PixelFormat::ARGB8888;
+    uint64_t* lineHashes = nullptr;  // SCREEN_HEIGHT個（任意）
+};
+
+// target の各行を frame の内容に揃える（frameLineHashes と target.lineHashes が一致する行は飛ばす）
+// PPUが描かなかった行（ステート復元・描画間引き）の補完用。書き直した行数を返す
+int syncFrameTarget(const uint8_t* frame, const uint64_t* frameLineHashes, const FrameTarget& target);
@@ -0,0 +1,133 @@
+/*
+ * libgameboy の C API
+ * ---------------------------
+ * SDLに依存しないエミュレーションコアを、C/ctypes等から操作するための安定したインターフェイス。
+ * 互換性を壊す変更をしたら GB_API_VERSION を上げる。
+ * 1つの gb_emulator は1スレッドから使うこと（別インスタンス同士は並行に使ってよい）。
+ */
+#ifndef GAMEBOY_C_H
+#define GAMEBOY_C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#define GB_API __declspec(dllexport)
+#else
+#define GB_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GB_API_VERSION 1
+
+#define GB_SCREEN_WIDTH  160
+#define GB_SCREEN_HEIGHT 144
+#define GB_FRAME_CYCLES  70224
+
+/* gb_set_input のボタンビット（1=押下） */
+enum {
+    GB_BUTTON_A      = 1 << 0,
+    GB_BUTTON_B      = 1 << 1,
+    GB_BUTTON_SELECT = 1 << 2,
+    GB_BUTTON_START  = 1 << 3,
+    GB_BUTTON_RIGHT  = 1 << 4,
+    GB_BUTTON_LEFT   = 1 << 5,
+    GB_BUTTON_UP     = 1 << 6,
+    GB_BUTTON_DOWN   = 1 << 7
+};
+
+/* gb_copy_frame の出力形式 */
+enum {
+    GB_PIXEL_ARGB8888 = 0,
+    GB_PIXEL_RGB565   = 1,
+    GB_PIXEL_GRAY8    = 2
+};
+
+/* gb_set_render_mode の描画モード（タイミングはどれも同じ） */
+enum {
+    GB_RENDER_FULL        = 0,  /* 毎フレーム描画 */
+    GB_RENDER_EVERY_NTH   = 1,  /* interval フレームに1回描画 */
+    GB_RENDER_TIMING_ONLY = 2   /* 描画しない（RAMだけを見るボット向け） */
+};
+
+typedef struct gb_emulator gb_emulator;
+
+GB_API uint32_t gb_api_version(void);
+
+GB_API gb_emulator* gb_create(void);
+GB_API void gb_destroy(gb_emulator* gb);
+
+/* ROMの読み込み（成功で0）。データはコピーされる */
+GB_API int gb_load_rom(gb_emulator* gb, const uint8_t* data, size_t size);
+GB_API int gb_load_rom_file(gb_emulator* gb, const char* path);
+
+/* 実行 */
+GB_API void gb_run_frame(gb_emulator* gb);
+GB_API void gb_run_cycles(gb_emulator* gb, uint64_t cycles);
+GB_API uint64_t gb_cycle_count(const gb_emulator* gb);
+GB_API void gb_set_render_mode(gb_emulator* gb, int mode, int interval);
+
+/* 入力（GB_BUTTON_* の論理和） */
+GB_API void gb_set_input(gb_emulator* gb, uint8_t buttons);
+
+/*
+ * 画面
+ * gb_get_framebuffer: 2bitシェード番号を1バイトに4ピクセル（下位ビットから）詰めたフレーム。
+ *   1ライン40バイト、全体 gb_framebuffer_size() バイト。コピーせずに内部バッファを指す
+ *   （次に実行系の関数を呼ぶまで有効）。
+ * gb_copy_frame: 指定形式へ変換してコピーする（pitchは1ラインのバイト数、0なら詰めて書く）。
+ */
+GB_API const uint8_t* gb_get_framebuffer(const gb_emulator* gb);
+GB_API size_t gb_framebuffer_size(void);
+GB_API void gb_copy_frame(const gb_emulator* gb, void* dst, int pitch, int format);
+GB_API uint64_t gb_frame_hash(const gb_emulator* gb);
+
+/* メモリ（CPUバスと同じ見え方） */
+GB_API uint8_t gb_read_memory(gb_emulator* gb, uint16_t addr);
+GB_API void gb_write_memory(gb_emulator* gb, uint16_t addr, uint8_t value);
+
+/*
+ * セーブステート
+ * gb_save_state: 必要なバイト数を返す。capacity がそれ以上なら buffer に書き込む。
+ * gb_load_state: 成功で0（失敗時は状態を変えない）。
+ */
+GB_API size_t gb_save_state(gb_emulator* gb, uint8_t* buffer, size_t capacity);
+GB_API int gb_load_state(gb_emulator* gb, const uint8_t* data, size_t size);
+
+/*
+ * 並列環境（強化学習向け。同じROMをN個まとめて1フレームずつ進める）
+ * 観測は呼び出し側のバッチバッファ（環境iは observations + i * gb_vec_observation_size()）へ
+ * 直接書き込む。エピソードが終わった環境はスタート状態から自動リセットし、dones[i] = 1。
+ */
+enum {
+    GB_OBS_PACKED_FRAME = 0,  /* gb_get_framebuffer と同じ形式 */
+    GB_OBS_GRAY8        = 1,  /* 160x144 8bitグレースケール */
+    GB_OBS_RAM          = 2   /* WRAM 8KB + HRAM + IE（描画を省略する） */
+};
+
+typedef struct gb_vec gb_vec;
+
+GB_API gb_vec* gb_vec_create(size_t env_count, size_t threads);  /* threads=0 で全コア */
+GB_API void gb_vec_destroy(gb_vec* vec);
+/* 全環境にROMを読み込み、warmup_frames 進めた状態をスタート状態にする（成功で0） */
+GB_API int gb_vec_load_rom_file(gb_vec* vec, const char* path, uint64_t warmup_frames);
+GB_API int gb_vec_set_start_state(gb_vec* vec, const uint8_t* data, size_t size);
+GB_API void gb_vec_set_observation(gb_vec* vec, int type);
+GB_API size_t gb_vec_observation_size(const gb_vec* vec);
+GB_API void gb_vec_set_episode_frames(gb_vec* vec, uint64_t frames);  /* 0 で上限なし */
+/* 実験的: 同一状態・同一行動の環境をまとめて1回だけ実行する（enabled=0で無効） */
+GB_API void gb_vec_set_lockstep(gb_vec* vec, int enabled);
+GB_API void gb_vec_reset(gb_vec* vec, uint8_t* observations);
+GB_API void gb_vec_step(gb_vec* vec, const uint8_t* actions, uint8_t* observations, uint8_t* dones);
+/* 直前のstep()と累計の全環境合計fps */
+GB_API double gb_vec_last_fps(const gb_vec* vec);
+GB_API double gb_vec_average_fps(const gb_vec* vec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GAMEBOY_C_H */
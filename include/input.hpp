@@ -1,6 +1,9 @@
 #pragma once
 #include <cstdint>
 
+class StateReader;
+class StateWriter;
+
 enum class JoypadButton {
     A = 0,      // bit 0
     B = 1,      // bit 1
@@ -22,6 +25,14 @@ public:
     uint8_t getJoypadState() const;
     void setJoypadRegister(uint8_t value);  // 0xFF00 P1レジスタ設定
 
+    // 全ボタンの押下状態（1=押下）。下位4bit: A,B,Select,Start / 上位4bit: Right,Left,Up,Down
+    uint8_t getButtonMask() const;
+    void setButtonMask(uint8_t mask);
+
+    // セーブステート（savestate.hpp）
+    void saveState(StateWriter& out) const;
+    void loadState(StateReader& in);
+
 private:
     uint8_t buttonStates = 0xFF;     // ボタン状態 (bit0-3: A,B,Select,Start)
     uint8_t directionStates = 0xFF;  // 方向キー状態 (bit0-3: Right,Left,Up,Down)
@@ -4,20 +4,55 @@
 #include <string>
 
 class Input;  // 前方宣言
+class Profiler;
+class TimelineRecorder;
+class Scheduler;
+class Timer;
+class Serial;
+class StateReader;
+class StateWriter;
 
 class Memory {
 public:
     Memory();
-    void loadROM(const std::string& path);
-    uint8_t readByte(uint16_t addr) const;
+    bool loadROM(const std::string& path);
+    bool loadROMData(const uint8_t* data, size_t size);
+    uint8_t readByte(uint16_t addr) const;       // CPUバスからのアクセス（必要なら同期してから）
     void writeByte(uint16_t addr, uint8_t val);
+    uint8_t readByteNoSync(uint16_t addr) const; // 同期処理の内側（DMAなど）からの読み出し
 
     // OAM DMA関連
     void stepDMA();
     void startDMA(uint8_t sourcePage);
+    int dmaCyclesUntilEvent() const { return dmaActive ? (160 - dmaCycles) + 1 : -1; }
+
+    // スケジューラ（VRAM/OAM/IOアクセス前にPPU等を追いつかせる）
+    void setScheduler(Scheduler* sched) { scheduler = sched; }
 
     // Input関連
     void setInputReference(Input* inputPtr);
+    // Timer関連（DIV/TAC書き込みを通知する）
+    void setTimerReference(Timer* timerPtr) { timer = timerPtr; }
+    // Serial関連（SB/SC書き込みで転送を開始する）
+    void setSerialReference(Serial* serialPtr) { serial = serialPtr; }
+    // 計測（GAMEBOY_PROFILE時のみ。CPUバスからのアクセスをMemory区間に数える）
+    void setProfiler(Profiler* profilerPtr) { profiler = profilerPtr; }
+    // タイムライン記録（OAM DMAの転送期間）
+    void setTimeline(TimelineRecorder* recorder) { timeline = recorder; }
+
+    // PPU内部アクセス用（ロック判定なし）
+    uint8_t readVRAM(uint16_t addr) const { return vram[addr & 0x1FFF]; }
+    const uint8_t* getOAM() const { return oam.data(); }
+    // 観測用（同期なしで直接参照する）
+    const uint8_t* getWRAM() const { return wram.data(); }
+    const uint8_t* getHRAM() const { return hram.data(); }
+
+    // 読み込んだROMの識別用ハッシュ（セーブステートの照合に使う）
+    uint64_t getROMHash() const { return romHash; }
+
+    // セーブステート（savestate.hpp）
+    void saveState(StateWriter& out) const;
+    void loadState(StateReader& in);
 
     uint8_t LY = 0;
     uint8_t if_reg = 0x00;
@@ -43,6 +78,9 @@ public:
     bool vramLocked = false;
     bool oamLocked  = false;
 
+    // OAMが書き換わったスプライト番号のビット集合（bit i = スプライトi）。PPUが消費する
+    uint64_t oamDirtyMask = 0xFFFFFFFFFFULL;
+
     // OAM DMA関連
     bool dmaActive = false;
     uint16_t dmaSource = 0;
@@ -51,6 +89,12 @@ public:
     // Input関連
     Input* input = nullptr;
 
+    Scheduler* scheduler = nullptr;
+    Timer* timer = nullptr;
+    Serial* serial = nullptr;
+    Profiler* profiler = nullptr;
+    TimelineRecorder* timeline = nullptr;
+
 private:
     std::vector<uint8_t> rom; // 完全なROMデータ（バンク切り替え対応）
     std::vector<uint8_t> vram; //8kb video ram
@@ -61,6 +105,7 @@ private:
     uint8_t romBankLower = 1;
     uint8_t romBankUpper = 0;
     uint8_t mbc1Mode = 0;
+    uint64_t romHash = 0;
 
     size_t currentROMBank() const;
     uint8_t readROM(uint16_t addr) const;
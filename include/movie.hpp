@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Emulator;
+
+// ---------------------------
+// 入力ムービー（記録と再生）
+// ---------------------------
+// 開始時点のセーブステートと、ボタン状態が変化したサイクル、
+// 各フレーム境界での状態ハッシュ（同期確認用）を持つ。時刻はマスタークロックの絶対値。
+
+struct MovieInput {
+    uint64_t cycle;
+    uint8_t buttons;    // Input::getButtonMask() 形式
+};
+
+struct MovieCheckpoint {
+    uint64_t cycle;
+    uint64_t stateHash; // Emulator::getStateHash()
+};
+
+struct Movie {
+    uint64_t romHash = 0;
+    std::vector<uint8_t> startState;
+    std::vector<MovieInput> inputs;             // 時刻順
+    std::vector<MovieCheckpoint> checkpoints;   // 時刻順
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+};
+
+// 再生結果
+struct MovieReplay {
+    bool started = false;           // 開始ステートを復元できたか
+    size_t checkpointsVerified = 0;
+    int64_t desyncCheckpoint = -1;  // 最初にハッシュが食い違ったチェックポイント（-1: なし）
+    uint64_t cycles = 0;
+    double wallSeconds = 0.0;
+
+    bool inSync() const { return started && desyncCheckpoint < 0; }
+};
+
+// ウィンドウなしで最速再生する（食い違ったらそこで止める）
+MovieReplay replayMovie(Emulator& emu, const Movie& movie);
@@ -1,17 +1,60 @@
 #pragma once
 #include <cstdint>
+#include <bitset>
 #include <deque>
 #include <string>
+#include "framebuffer.hpp"
 
 class Memory;
+class TimelineRecorder;
+class StateReader;
+class StateWriter;
 
 class PPU {
 public:
+    // 描画モード（タイミング＝STAT/LY/割り込みは全モードで同一）
+    enum class RenderMode {
+        Full,        // 毎フレーム描画
+        EveryNth,    // Nフレームに1回だけ描画
+        TimingOnly   // 描画しない（タイミングのみ生成）
+    };
+
     PPU(Memory& mem);
     void step(int cycles);
+    int cyclesUntilEvent() const;   // 次にSTAT/LY/割り込みが変化し得るまでのサイクル数（-1: なし）
     void reset();
-    const uint32_t* getFrameBuffer() const{ return framebuffer;}
+    // 2bitシェード番号を4ピクセル/バイトで詰めたフレーム（framebuffer.hpp参照）
+    const uint8_t* getFrameBuffer() const{ return framebuffer;}
+    // 必要になった時点で指定形式へ変換する
+    void convertFrame(void* dst, int pitch, PixelFormat fmt) const;
     void saveFramePPM(const std::string& path) const;
+    // 描き終えたラインを変換して呼び出し側のメモリへも書き込む（pixels=nullptrで解除）
+    // 描画しない行は書かないので、必要なら syncFrameTarget() で補う。ステートには含めない
+    void setFrameTarget(const FrameTarget& target);
+    const FrameTarget& getFrameTarget() const { return frameTarget; }
+
+    // ライン単位のハッシュと前フレームからの差分（描画したフレームのみ更新）
+    const uint64_t* getLineHashes() const { return lineHashes; }
+    uint64_t getFrameHash() const { return frameHash; }                    // 直近に完成したフレーム
+    const std::bitset<SCREEN_HEIGHT>& getDirtyLines() const { return frameDirtyLines; }
+    bool frameChanged() const { return frameDirtyLines.any(); }
+    uint64_t getCompletedFrames() const { return completedFrames; }        // 完成フレーム数（新フレーム検出用）
+
+    void setRenderMode(RenderMode mode, int interval = 1);
+    RenderMode getRenderMode() const { return renderMode; }
+    int getRenderInterval() const { return renderInterval; }
+    bool isRenderingFrame() const { return renderThisFrame; }
+
+    // タイムライン記録（フレーム・ライン・モードのスパン）。clockはエミュレーション時間で、
+    // ステートには含めないので復元後に合わせ直す
+    void setTimeline(TimelineRecorder* recorder) { timeline = recorder; }
+    void setClock(uint64_t cycle) { clock = cycle; }
+
+    // セーブステート（描画途中のフレームとフェッチャー状態を含む。描画モード設定は含まない）
+    void saveState(StateWriter& out) const;
+    void loadState(StateReader& in);
+    // ゲームの進行に関わる部分（LY/モード/ドット位置）だけ。描画モードによらず同じ値になる
+    void saveTimingState(StateWriter& out) const;
 
 
 private:
@@ -28,10 +71,23 @@ private:
     uint8_t currentLine = 0;
     uint8_t mode = 2;           // LCDモード (0: HBlank, 1: VBlank, 2: OAM, 3: Transfer)
     bool coincidence = false;   // LYC=LY フラグ
-    uint32_t framebuffer[160*144];//出力先ピクセル
-    uint8_t bgLineColor[160]{};  // 背景/ウィンドウの色番号（スプライト優先判定用）
+    uint8_t framebuffer[FRAME_BYTES];//出力先ピクセル（2bitシェード番号）
 
     int dotCounter = 0;         // 現在のライン内ドット位置
+    uint64_t clock = 0;         // step()で進んだ先のエミュレーション時間（タイムライン用）
+    TimelineRecorder* timeline = nullptr;
+    FrameTarget frameTarget;        // 直接書き込む先（pitchは設定時に確定させる）
+
+    RenderMode renderMode = RenderMode::Full;
+    int renderInterval = 1;         // EveryNth時の間隔
+    uint64_t frameCounter = 0;      // フレーム番号（間引き判定用）
+    bool renderThisFrame = true;    // 現フレームでフェッチャー/スプライト処理を行うか
+
+    uint64_t lineHashes[SCREEN_HEIGHT]{};          // 各ラインの最新ハッシュ
+    std::bitset<SCREEN_HEIGHT> dirtyLines;         // 描画中フレームで前フレームから変化したライン
+    std::bitset<SCREEN_HEIGHT> frameDirtyLines;    // 直近に完成したフレームの差分
+    uint64_t frameHash = 0;
+    uint64_t completedFrames = 0;
 
     std::deque<uint8_t> bgFifo;
     uint8_t fetchTileNumber = 0;
@@ -49,18 +105,37 @@ private:
     int windowTriggerX = 0;
     uint8_t scxDiscard = 0;
     int fetcherDotCounter = 0;      // フェッチャーの動作ドット数カウンタ
+    uint8_t cachedWX = 0;           // Mode3中のWX変更検出用（インスタンスごとに保持）
 
     SpriteLine spriteLineBuffer[10];
     int spriteCount = 0;
 
+    // OAMのラインごとのスプライト索引（OAM書き込み/DMAで差分更新）
+    uint64_t lineSpriteMask[SCREEN_HEIGHT]{};   // bit i = スプライトiがそのラインに掛かる
+    uint8_t spriteFirstLine[40]{};              // 各スプライトが掛かる可視ライン範囲
+    uint8_t spriteLineCount[40]{};
+    int indexHeight = 0;                        // 索引を作ったスプライト高さ（0=未構築）
+    uint8_t lineSprites[SCREEN_HEIGHT][10]{};   // ライン毎の採用スプライト（X順、最大10）
+    uint8_t lineSpriteCount[SCREEN_HEIGHT]{};
+    std::bitset<SCREEN_HEIGHT> lineSpritesValid;
+
     void setMode(uint8_t newMode);
     void updateCoincidence();
     void enterMode2();
     void enterMode3();
     void enterMode0();
     void enterVBlank();
+    void beginFrame();
+    void endLine();
+    void recordLine(uint64_t lineEnd) const;
+    int quietDotsAhead() const;
+    void finishLine();
+    void finishFrame();
     void stepMode3(int dotCounter);
     void gatherSprites();
-    uint8_t readPPUByte(uint16_t addr);
-    uint32_t decodeDMGColor(uint8_t palette, uint8_t colorId) const;
+    void updateSpriteIndex(int spriteHeight);
+    void removeSpriteFromIndex(int index);
+    void addSpriteToIndex(int index, int spriteHeight);
+    void buildLineSprites(int line);
+    uint8_t decodeDMGShade(uint8_t palette, uint8_t colorId) const;
 };
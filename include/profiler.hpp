@@ -0,0 +1,130 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+// ---------------------------
+// サブシステム別の時間計測（サンプリング方式）
+// ---------------------------
+// 各処理の入口で「いま何をしているか」（区間）を書き換えておき、一定周期のSIGPROF
+// （プロセスのCPU時間に対するタイマー）で割り込んだスレッドの区間に、前回のサンプルから
+// そのスレッドが使ったCPU時間を足す。周期はカーネルのティックに丸められることがあるが
+// （SAMPLE_HZは目安）、重みは実測なので合計は計測中のCPU時間に一致する。
+// 計測側の負担はホットパスでの区間の付け替え（ストア2回）だけで、時刻の読み出しはしない。
+// 区間は入れ子にでき、内側が優先される（例: CPU命令中のメモリアクセスはMemoryに数える）。
+//
+// CMakeの GAMEBOY_PROFILE=ON でビルドしたときだけ有効。無効時は GB_PROFILE_* が空になり、
+// Emulatorも計測器を持たない。SIGUSR1を受けると、各インスタンスが次のフレーム境界で
+// 統計をJSONで標準エラーへ出す。
+
+enum class ProfileSection : uint8_t {
+    Other = 0,     // どの区間にも入っていない（実行ループ・フロントエンドなど）
+    CPU,           // CPU::step（メモリアクセスを除く）
+    Memory,        // Memory::readByte / writeByte（同期を除く）
+    PPUHBlank,     // PPU::step（モード0）
+    PPUVBlank,     // PPU::step（モード1）
+    PPUOAMScan,    // PPU::step（モード2）
+    PPUTransfer,   // PPU::step（モード3）
+    Timer,         // Timer::step
+    DMA,           // OAM DMAの1バイト転送
+    Events,        // スケジューラの同期とイベント処理（シリアル含む）
+    Display,       // Display::updateFrame（テクスチャ転送と表示）
+    Count
+};
+
+const char* profileSectionName(ProfileSection section);
+
+// 計測値（区間ごとのサンプル数と、割り当てたCPU時間）
+struct ProfileStats {
+    static constexpr int SECTION_COUNT = static_cast<int>(ProfileSection::Count);
+
+    bool enabled = false;            // GAMEBOY_PROFILE でビルドされているか
+    uint64_t samples[SECTION_COUNT] = {};
+    uint64_t nanoseconds[SECTION_COUNT] = {};
+    uint64_t totalSamples = 0;
+    uint64_t totalNanoseconds = 0;
+    double wallSeconds = 0.0;        // 計測開始（またはリセット）からの実時間
+
+    double seconds(ProfileSection section) const {
+        return nanoseconds[static_cast<int>(section)] * 1e-9;
+    }
+    double share(ProfileSection section) const {  // 0..1
+        return totalNanoseconds ? double(nanoseconds[static_cast<int>(section)]) / totalNanoseconds : 0.0;
+    }
+    void writeJSON(std::ostream& out) const;  // JSONオブジェクト1つを出力（改行なし）
+};
+
+class Profiler {
+public:
+    static constexpr int SAMPLE_HZ = 2000;
+
+    Profiler();   // 最初のインスタンスでシグナルとタイマーを設定する
+    ~Profiler();  // 最後のインスタンスで元に戻す
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    ProfileSection enter(ProfileSection section) {
+        const ProfileSection saved = current.load(std::memory_order_relaxed);
+        current.store(section, std::memory_order_relaxed);
+        return saved;
+    }
+    void leave(ProfileSection saved) { current.store(saved, std::memory_order_relaxed); }
+
+    ProfileStats getStats() const;
+    void reset();
+    // SIGUSR1を受けてから、このインスタンスがまだ出力していなければtrue
+    bool consumeDumpRequest();
+
+private:
+    friend class ProfileThread;
+    friend void profilerSampleHandler(int);
+
+    std::atomic<ProfileSection> current{ProfileSection::Other};
+    std::atomic<uint64_t> samples[ProfileStats::SECTION_COUNT];
+    std::atomic<uint64_t> nanoseconds[ProfileStats::SECTION_COUNT];
+    uint64_t lastSampleCPU = 0;   // 前回のサンプル（または登録）時点のスレッドCPU時間[ns]
+    std::chrono::steady_clock::time_point startTime;
+    uint64_t dumpGeneration = 0;
+};
+
+// このスレッドで実行中の計測器を登録する（SIGPROFは割り込んだスレッドの計測器に数える）
+class ProfileThread {
+public:
+    explicit ProfileThread(Profiler* profiler);
+    ~ProfileThread();
+    ProfileThread(const ProfileThread&) = delete;
+    ProfileThread& operator=(const ProfileThread&) = delete;
+
+private:
+    Profiler* saved;
+};
+
+// 区間を入れ子で付け替える（profilerがnullなら何もしない）
+class ProfileScope {
+public:
+    ProfileScope(Profiler* profiler, ProfileSection section) : profiler(profiler) {
+        if (profiler) saved = profiler->enter(section);
+    }
+    ~ProfileScope() {
+        if (profiler) profiler->leave(saved);
+    }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    Profiler* profiler;
+    ProfileSection saved = ProfileSection::Other;
+};
+
+#ifdef GAMEBOY_PROFILE
+#define GB_PROFILE_JOIN2(a, b) a##b
+#define GB_PROFILE_JOIN(a, b) GB_PROFILE_JOIN2(a, b)
+#define GB_PROFILE_SCOPE(profiler, section) \
+    ProfileScope GB_PROFILE_JOIN(profileScope_, __LINE__)((profiler), (section))
+#define GB_PROFILE_THREAD(profiler) \
+    ProfileThread GB_PROFILE_JOIN(profileThread_, __LINE__)((profiler))
+#else
+#define GB_PROFILE_SCOPE(profiler, section) ((void)0)
+#define GB_PROFILE_THREAD(profiler) ((void)0)
+#endif
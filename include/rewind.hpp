@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+// ---------------------------
+// 巻き戻し用のスナップショット履歴
+// ---------------------------
+// 一定間隔でキーフレーム（セーブステートそのまま）を置き、その間のスナップショットは
+// キーフレームとのXORをランレングス圧縮した差分として、固定サイズのリングに詰める。
+// 容量を超えたら古いものから捨てる（キーフレームを捨てたらそれに依存する差分も捨てる）。
+class RewindBuffer {
+public:
+    explicit RewindBuffer(size_t capacityBytes = 32 * 1024 * 1024, int keyframeInterval = 60);
+
+    void push(const std::vector<uint8_t>& state);  // 最新のスナップショットとして追加
+    bool pop(std::vector<uint8_t>& state);         // 最新を取り出して履歴から外す（空ならfalse）
+    void clear();
+
+    size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+    size_t bytesUsed() const;
+
+private:
+    struct Entry {
+        size_t offset;      // リング内の位置
+        size_t size;        // 圧縮後のバイト数
+        uint64_t keySeq;    // 基準キーフレームの通し番号（自身がキーフレームなら自分）
+        uint64_t seq;
+        bool keyframe;
+    };
+
+    std::unique_ptr<uint8_t[]> ring;    // 初回push時に確保
+    size_t capacity;
+    int keyframeInterval;
+    std::deque<Entry> entries;          // 古い順
+    uint64_t nextSeq = 0;
+
+    std::vector<uint8_t> keyframe;      // 差分の基準（直近のキーフレームの生データ）
+    uint64_t keyframeSeq = 0;
+    int sinceKeyframe = 0;
+    bool needKeyframe = true;
+    std::vector<uint8_t> scratch;
+
+    uint8_t* allocate(size_t bytes, size_t& offset);  // 古いエントリを追い出して領域を確保
+    const Entry* findEntry(uint64_t seq) const;
+};
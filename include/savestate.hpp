@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ---------------------------
+// セーブステートの入出力
+// ---------------------------
+// すべてリトルエンディアン固定で詰めるので、ホストのエンディアンに依存しない。
+// 各コンポーネントは4文字のタグで区切って書き、読み込み時にタグで検証する。
+
+constexpr uint32_t STATE_MAGIC = 0x54534247;   // "GBST"
+constexpr uint16_t STATE_VERSION = 3;          // 形式を変えたら上げる
+
+class StateWriter {
+public:
+    explicit StateWriter(std::vector<uint8_t>& out) : buffer(out) {}
+
+    void write8(uint8_t v) { buffer.push_back(v); }
+    void write16(uint16_t v);
+    void write32(uint32_t v);
+    void write64(uint64_t v);
+    void writeBool(bool v) { write8(v ? 1 : 0); }
+    void writeBytes(const uint8_t* data, size_t size);
+    void writeTag(const char (&tag)[5]);
+
+private:
+    std::vector<uint8_t>& buffer;
+};
+
+class StateReader {
+public:
+    StateReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    uint8_t read8();
+    uint16_t read16();
+    uint32_t read32();
+    uint64_t read64();
+    bool readBool() { return read8() != 0; }
+    void readBytes(uint8_t* dst, size_t count);
+    bool expectTag(const char (&tag)[5]);   // 不一致ならエラー状態にする
+    // 読み出した値の検証用: conditionが偽ならエラー状態にする
+    bool require(bool condition) {
+        if (!condition) valid = false;
+        return valid;
+    }
+
+    // 範囲外読み出し・タグ不一致が一度でもあればfalse（以降の読み出しは0を返す）
+    bool ok() const { return valid; }
+    bool atEnd() const { return pos == size; }
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+    bool valid = true;
+};
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+
+class Memory;
+class PPU;
+class Profiler;
+class Serial;
+class StateReader;
+class StateWriter;
+class Timer;
+
+// ---------------------------
+// マスタークロックとイベント管理
+// ---------------------------
+// CPUは次のイベント期限まで命令を実行し続け、PPU/Timer/DMA/Serialは
+// 期限到来時か、CPUがそれらのレジスタ・VRAM・OAMに触れた時にだけ
+// まとめて追いつかせる（遅延同期）。
+class Scheduler {
+public:
+    // イベントの種類（コンポーネントごとに1枠）
+    enum class Event : int {
+        PPU = 0,    // モード遷移・ライン送り
+        Timer,      // TIMA更新
+        DMA,        // OAM DMA完了
+        Serial,     // シリアル転送完了
+        APU,        // 将来用
+        Frame,      // 実行ループ側のフレーム境界
+        Count
+    };
+    static constexpr uint64_t NEVER = UINT64_MAX;
+
+    Scheduler(PPU& ppu, Timer& timer, Serial& serial, Memory& memory);
+    void reset();
+
+    uint64_t now() const { return cycles; }              // CPU側の現在時刻（Tサイクル）
+    void advance(uint64_t c) { cycles += c; }            // CPU命令の実行分だけ進める
+    bool eventDue() const { return cycles >= nextDeadline; }
+    uint64_t getNextDeadline() const { return nextDeadline; }
+
+    void schedule(Event e, uint64_t when);
+    void requestSync() { nextDeadline = cycles; }        // 次の命令の前に必ず同期させる
+    void sync();                                         // 全コンポーネントを now() まで進める
+    void setProfiler(Profiler* p) { profiler = p; }      // 計測（GAMEBOY_PROFILE時のみ）
+
+    // セーブステート（sync()直後に呼ぶこと。実行ループ側の期限は含まない）
+    void saveState(StateWriter& out) const;
+    void loadState(StateReader& in);
+
+private:
+    PPU& ppu;
+    Timer& timer;
+    Serial& serial;
+    Memory& memory;
+    Profiler* profiler = nullptr;
+
+    uint64_t cycles = 0;                                  // マスタークロック
+    uint64_t syncedTo = 0;                                // コンポーネントが進んだ時刻
+    uint64_t deadlines[static_cast<int>(Event::Count)];
+    uint64_t nextDeadline = 0;
+
+    void catchUp(uint64_t delta);
+    void stepPPU(int cycles);
+    void stepTimer(int cycles);
+    void updateNextDeadline();
+    void scheduleIn(Event e, int cyclesAhead);           // 負数ならイベントなし
+};
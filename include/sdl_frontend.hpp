@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+
+class Display;
+class Emulator;
+
+// ウィンドウ実行の設定
+struct FrontendOptions {
+    double speed = 1.0;                          // 1.0=実機の59.7275Hz, 0以下で無制限
+    size_t rewindBytes = 64 * 1024 * 1024;       // 巻き戻し履歴の容量（0で無効）。毎フレーム保存で数分ぶん
+    std::string movieRecordPath;                 // 入力をムービーとして記録する（空なら記録しない）
+    int runAheadFrames = 0;                      // 先読みして表示するフレーム数（0で無効）
+};
+
+// ---------------------------
+// SDL2ウィンドウ付きの実行ループ
+// ---------------------------
+// エミュレータは公開APIだけで操作する（コアはSDLに依存しない）。
+// このヘッダはSDLを含まない。実装はSDL2が見つかった時だけビルドされる。
+// エミュレーション（実行・ペーシング・巻き戻し・記録）は専用スレッドで回し、完成したフレームを
+// トリプルバッファで公開する。呼び出したスレッドはSDLのイベント処理と最新フレームの表示だけを行い、
+// キー入力はSPSCキューで渡す。どちらの方向も相手を待たないので、表示（vsyncを含む）が
+// エミュレーションを止めることはない。
+class SDLFrontend {
+public:
+    SDLFrontend(Emulator& emu, const FrontendOptions& options = {});
+    ~SDLFrontend();
+    void run();
+
+private:
+    struct Channels;  // スレッド間の受け渡し（sdl_frontend.cpp）
+
+    Emulator& emu;
+    FrontendOptions options;
+    std::unique_ptr<Display> display;
+
+    void emulationLoop(Channels& channels);  // エミュレーションスレッド
+    void displayLoop(Channels& channels);    // 呼び出したスレッド（SDL）
+};
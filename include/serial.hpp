@@ -0,0 +1,61 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class Memory;
+class StateReader;
+class StateWriter;
+
+// ---------------------------
+// シリアルポート（SB/SC, 0xFF01-0xFF02）
+// ---------------------------
+// 内部クロック転送は 8bit × 512サイクル で完了し、完了時に
+// SC.bit7 をクリアしてシリアル割り込み(IF bit3)を立てる。
+// 送信したバイトは登録されたシンクへ渡す（通信相手はいないので受信は0xFF）。
+class Serial {
+public:
+    static constexpr int TRANSFER_CYCLES = 8 * 512;
+
+    explicit Serial(Memory* mem);
+    void reset();
+    void step(int cycles);
+    int cyclesUntilEvent() const;   // 転送完了までのサイクル数（-1: 転送なし）
+
+    // CPUからのレジスタ書き込み
+    void writeSB(uint8_t val);
+    void writeSC(uint8_t val);
+
+    // 送信バイトの受け取り先
+    void setSink(std::function<void(uint8_t)> sinkFn) { sink = std::move(sinkFn); }
+
+    // セーブステート（savestate.hpp）
+    void saveState(StateWriter& out) const;
+    void loadState(StateReader& in);
+
+private:
+    Memory* memory;
+    bool transferActive = false;
+    int cyclesRemaining = 0;
+    std::function<void(uint8_t)> sink;
+
+    void completeTransfer();
+};
+
+// 複数パターンの逐次照合（Aho-Corasick をDFA化したもの）。1バイトあたり表引き1回
+class SerialMatcher {
+public:
+    SerialMatcher() = default;
+    explicit SerialMatcher(const std::vector<std::string>& patterns);
+
+    int feed(uint8_t byte);          // このバイトで一致したパターンの番号（なければ-1）
+    void reset() { state = 0; }
+    bool empty() const { return transitions.empty(); }
+
+private:
+    std::vector<std::array<int, 256>> transitions;
+    std::vector<int> matchAt;        // 状態ごとの一致パターン番号（-1: なし）
+    int state = 0;
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+// ---------------------------
+// 固定長のSPSCキュー（書き手1・読み手1、wait-free）
+// ---------------------------
+// push/popとも有限ステップで終わり、満杯/空ならその場でfalseを返す（待たない）。
+// 相手側の位置は満杯/空に見えたときだけ読み直すので、通常はキャッシュラインを共有しない。
+template <typename T, size_t Capacity>
+class SPSCQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SPSCQueue() = default;
+    SPSCQueue(const SPSCQueue&) = delete;
+    SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+    // 書き手: 満杯ならfalse
+    bool push(const T& value) {
+        const size_t tail = tailIndex.load(std::memory_order_relaxed);
+        if (tail - headCache == Capacity) {
+            headCache = headIndex.load(std::memory_order_acquire);
+            if (tail - headCache == Capacity) {
+                return false;
+            }
+        }
+        items[tail & (Capacity - 1)] = value;
+        tailIndex.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 読み手: 空ならfalse
+    bool pop(T& out) {
+        const size_t head = headIndex.load(std::memory_order_relaxed);
+        if (head == tailCache) {
+            tailCache = tailIndex.load(std::memory_order_acquire);
+            if (head == tailCache) {
+                return false;
+            }
+        }
+        out = items[head & (Capacity - 1)];
+        headIndex.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    // 書き手側
+    alignas(64) std::atomic<size_t> tailIndex{0};
+    size_t headCache = 0;
+    // 読み手側
+    alignas(64) std::atomic<size_t> headIndex{0};
+    size_t tailCache = 0;
+
+    alignas(64) T items[Capacity] = {};
+};
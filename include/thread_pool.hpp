@@ -0,0 +1,47 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ---------------------------
+// ワークスティーリング型スレッドプール
+// ---------------------------
+// ワーカーごとにキューを持ち、自分のキューは後ろから取り出し、
+// 空になったら他のワーカーのキューの先頭から盗む。
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threadCount = 0);  // 0ならハードウェアスレッド数
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+    void wait();  // 投入済みのタスクがすべて終わるまで待つ
+    size_t size() const { return workers.size(); }
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> nextQueue{0};
+
+    std::mutex stateMutex;
+    std::condition_variable workAvailable;
+    std::condition_variable allDone;
+    size_t queued = 0;    // キューに積まれているタスク数
+    size_t pending = 0;   // 未完了のタスク数（実行中を含む）
+    bool stopping = false;
+
+    void workerLoop(size_t index);
+    bool popTask(size_t index, std::function<void()>& task);
+};
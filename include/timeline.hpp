@@ -0,0 +1,74 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// ---------------------------
+// タイムライン記録（Chrome trace event 形式のJSONへ書き出す）
+// ---------------------------
+// ゲーム内の出来事（フレーム・ライン・PPUモード・割り込み・OAM DMA・HALT）はエミュレーション時間
+// （Tサイクル）で、ホスト側の処理（runFrame・画面表示）は実時間で記録する。書き出し時に
+// それぞれ別プロセス（guest / host）として並べるので、chrome://tracing や Perfetto UI で開ける。
+// 記録はスレッドごとのバッファへ追記するだけ（書き込むのはそのスレッドのみでロック不要）。
+// バッファは最初の記録時に一度だけ登録し、writeJSON()で全スレッド分をまとめて書き出す。
+// 各コンポーネントはポインタがnullなら何もしないので、無効時の負担は分岐1つ。
+
+class TimelineRecorder {
+public:
+    // ゲーム側のトラック（同じトラック内のスパンは入れ子になるように記録する）
+    enum class Track : uint8_t {
+        PPU = 0,   // フレーム ⊃ VBlank ⊃ ライン ⊃ モード
+        CPU,       // 割り込み受付・HALT
+        DMA,       // OAM DMA
+        Count
+    };
+
+    // maxEventsPerThread: 1スレッドのバッファ上限（超えた分は数えて捨てる）
+    explicit TimelineRecorder(size_t maxEventsPerThread = 4u << 20);
+    TimelineRecorder(const TimelineRecorder&) = delete;
+    TimelineRecorder& operator=(const TimelineRecorder&) = delete;
+
+    // name / argName は文字列リテラル（書き出しまでポインタのまま保持する）
+    void guestSpan(Track track, const char* name, uint64_t startCycle, uint64_t cycles,
+                   const char* argName = nullptr, int64_t arg = 0);
+    void guestInstant(Track track, const char* name, uint64_t cycle,
+                      const char* argName = nullptr, int64_t arg = 0);
+    uint64_t hostNow() const;  // 記録開始からのナノ秒
+    void hostSpan(const char* name, uint64_t startNs, uint64_t endNs,
+                  const char* argName = nullptr, int64_t arg = 0);
+
+    // 全スレッドの記録を書き出す（記録しているスレッドが止まってから呼ぶこと）
+    bool writeJSON(const std::string& path) const;
+    size_t eventCount() const;
+    size_t droppedCount() const;
+
+private:
+    struct Event {
+        const char* name;
+        const char* argName;
+        uint64_t start;      // ゲーム側: Tサイクル / ホスト側: ナノ秒
+        uint64_t duration;
+        int64_t arg;
+        uint8_t track;       // Track、ホスト側は HOST_TRACK
+        bool instant;
+    };
+    struct ThreadBuffer {
+        int index;
+        std::vector<Event> events;
+        size_t dropped = 0;
+    };
+    static constexpr uint8_t HOST_TRACK = 0xFF;
+
+    size_t maxEventsPerThread;
+    std::chrono::steady_clock::time_point startTime;
+    mutable std::mutex registryMutex;                 // バッファの登録と書き出しだけで使う
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    const uint64_t id;                                // スレッド側のキャッシュの照合用
+
+    ThreadBuffer& threadBuffer();
+    void append(const Event& event);
+};
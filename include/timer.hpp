@@ -2,14 +2,28 @@
 #include <cstdint>
 
 class Memory;  // 前方宣言でOK
+class StateReader;
+class StateWriter;
 
 class Timer {
 public:
     explicit Timer(Memory* mem);
     void reset();
-    void step(int cycles);  // CPUの命令実行サイクルを渡して進める
+    void step(int cycles);  // 経過サイクル分だけ進める（DIV/TIMAは算術的に更新）
+    int cyclesUntilEvent() const;  // 次のTIMAオーバーフローまでのサイクル数（-1: 停止中）
+
+    // CPUからのレジスタ書き込み（立ち下がりエッジのグリッチを含む）
+    void writeDIV();
+    void writeTAC(uint8_t val);
+
+    // セーブステート（savestate.hpp）
+    void saveState(StateWriter& out) const;
+    void loadState(StateReader& in);
 
 private:
     Memory* memory;
     uint16_t divCounter;    // 内部クロックカウンタ
+
+    static bool timerSignal(uint8_t tac, uint16_t counter);
+    void incrementTIMA(uint32_t count);
 };
@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// ---------------------------
+// ロックフリーのトリプルバッファ（書き手1・読み手1）
+// ---------------------------
+// 書き手は自分の面に書いて publish() で中央の面と交換し、読み手は update() で新しい面が
+// あれば中央の面と交換してから読む。どちらも交換1回で終わり、相手を待たない。
+// 読み手が追いつかなければ古い面は読まれずに上書きされる（常に最新だけが届く）。
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // 書き手: 次に公開する面
+    T& writeBuffer() { return slots[back]; }
+    // 書き手: 書き終えた面を公開する（以後 writeBuffer() は別の面を返す）
+    void publish() {
+        const uint8_t previous = middle.exchange(static_cast<uint8_t>(back | FRESH), std::memory_order_acq_rel);
+        back = previous & INDEX_MASK;
+    }
+
+    // 読み手: 前回から新しい面が公開されていれば取り込んでtrue
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+        const uint8_t previous = middle.exchange(front, std::memory_order_acq_rel);
+        front = previous & INDEX_MASK;
+        return true;
+    }
+    // 読み手: 最後に取り込んだ面（一度も取り込んでいなければ初期値のまま）
+    const T& readBuffer() const { return slots[front]; }
+
+private:
+    static constexpr uint8_t INDEX_MASK = 0x03;
+    static constexpr uint8_t FRESH = 0x04;   // 中央の面が未読
+
+    T slots[3] = {};
+    alignas(64) std::atomic<uint8_t> middle{1};
+    alignas(64) uint8_t back = 0;    // 書き手だけが触る
+    alignas(64) uint8_t front = 2;   // 読み手だけが触る
+};
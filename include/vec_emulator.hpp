@@ -0,0 +1,116 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "emulator.hpp"
+#include "thread_pool.hpp"
+
+// ---------------------------
+// 強化学習向けの並列環境（同じROMをN個まとめて1フレームずつ進める）
+// ---------------------------
+// N個のEmulatorを1つの配列に持ち、step()で各環境に行動（ボタンマスク）を与えて1フレーム進める。
+// 環境は連続した範囲ごとにスレッドプールへ振り分ける。観測は呼び出し側のバッチバッファ
+// （環境i の観測は observations + i * observationSize()）へ直接書き込む。
+// エピソードが終わった環境は共有のスタート状態から自動でリセットし、
+// その回の観測はリセット後のものを返す（dones[i] = 1）。
+//
+// ロックステップ（実験的）: 同じスタート状態から同じ行動列を受けた環境はビット単位で同じ状態にある。
+// そうした環境を1つのグループとして持ち、グループの先頭（リーダー）だけを実行して、
+// 残りには結果の状態を写す。行動が食い違ったらその場でグループを分け、それぞれを単独で実行する。
+// 同じフレームにリセットした環境は再び1つのグループにまとまる。
+
+enum class ObservationType {
+    PackedFrame,  // 2bitシェードを詰めたフレーム（FRAME_BYTES）
+    Gray8Frame,   // 8bitグレースケール（SCREEN_WIDTH * SCREEN_HEIGHT）
+    RAM           // WRAM(0xC000-0xDFFF) + HRAM(0xFF80-0xFFFE) + IE(0xFFFF)
+};
+
+// 計測値（step()ごとに更新）
+struct VecStats {
+    uint64_t steps = 0;            // step()の呼び出し回数
+    uint64_t envFrames = 0;        // 全環境で進めたフレーム数の合計
+    uint64_t resets = 0;           // 自動リセットの回数
+    uint64_t executedFrames = 0;   // 実際にエミュレートしたフレーム数（ロックステップで写した分を除く）
+    uint64_t instructions = 0;     // 全環境が進んだ命令数（写した分も含む）
+    uint64_t executedInstructions = 0;  // 実際に実行した命令数
+    size_t lastGroups = 0;         // 直前のstep()で実行したグループ数（ロックステップ無効なら環境数）
+    double lastStepSeconds = 0.0;  // 直前のstep()の実時間
+    double lastFramesPerSecond = 0.0;  // 直前のstep()の全環境合計fps
+    double totalStepSeconds = 0.0;
+
+    double averageFramesPerSecond() const;  // これまでの全環境合計fps
+    double instructionsPerSecond() const;   // これまでの全環境合計の命令/秒
+};
+
+class VecEmulator {
+public:
+    static constexpr size_t RAM_OBSERVATION_BYTES = 0x2000 + 0x80;
+
+    // threads=0ならハードウェアスレッド数
+    explicit VecEmulator(size_t envCount, size_t threads = 0);
+
+    // 全環境に同じROMを読み込み、warmupFrames進めた状態をスタート状態にして全環境をそろえる
+    bool loadROM(const std::string& path, uint64_t warmupFrames = 0);
+    bool loadROMData(const uint8_t* data, size_t size, uint64_t warmupFrames = 0);
+    // スタート状態を差し替える（セーブステート形式。例: ステージ開始時点）
+    bool setStartState(const uint8_t* data, size_t size);
+    const std::vector<uint8_t>& getStartState() const { return startState; }
+
+    void setObservation(ObservationType type);  // RAMなら描画を省略する
+    ObservationType getObservation() const { return observation; }
+    size_t observationSize() const;
+
+    // エピソードの終了条件（どちらか満たしたら自動リセット）。doneはワーカースレッドから呼ばれる
+    void setEpisodeFrames(uint64_t frames) { episodeFrames = frames; }  // 0なら上限なし
+    void setDoneCondition(std::function<bool(const Emulator&)> done) { doneCondition = std::move(done); }
+    // ロックステップ実行（既定は無効）。doneの判定は状態だけから決まること
+    void setLockstep(bool enabled);
+    bool isLockstep() const { return lockstep; }
+
+    // 全環境をスタート状態に戻し、observations（nullなら書かない）へ観測を書く
+    void reset(uint8_t* observations);
+    // actions[i]: 環境iのボタンマスク（Input::getButtonMask()形式）
+    // dones（nullなら書かない）: このステップでエピソードが終わって自動リセットした環境は1
+    void step(const uint8_t* actions, uint8_t* observations, uint8_t* dones);
+
+    size_t size() const { return envCount; }
+    size_t threadCount() const { return pool.size(); }
+    Emulator& env(size_t index);  // 書き換えられる前提で、この環境をグループから外す
+    const Emulator& env(size_t index) const { return envs[index]; }
+    uint64_t episodeFrame(size_t index) const { return frameInEpisode[index]; }
+    const VecStats& getStats() const { return stats; }
+
+private:
+    size_t envCount;
+    std::unique_ptr<Emulator[]> envs;       // 連続した配列（環境ごとに独立、共有状態なし）
+    std::vector<uint64_t> frameInEpisode;
+    std::vector<uint8_t> resetFlags;        // step()中に各ワーカーが自分の範囲だけ書く
+    std::vector<uint64_t> stepInstructions; // 直前のstep()で各環境が進んだ命令数
+    std::vector<uint8_t> startState;
+    ThreadPool pool;
+
+    // ロックステップ用: 同じ番号の環境は同一状態。リーダーは自分の状態をgroupStateに保存して配る
+    bool lockstep = false;
+    std::vector<uint64_t> groupOf;
+    uint64_t nextGroup = 0;
+    std::vector<size_t> leaderOf;
+    std::vector<size_t> leaders;
+    std::vector<size_t> followers;
+    std::vector<uint8_t> hasFollowers;
+    std::vector<std::vector<uint8_t>> groupState;
+
+    ObservationType observation = ObservationType::PackedFrame;
+    uint64_t episodeFrames = 0;
+    std::function<bool(const Emulator&)> doneCondition;
+    VecStats stats;
+
+    // [0, count) をスレッドプールで分担する（スレッド数の4倍に分けてスティールで偏りをならす）
+    void forEachShard(size_t count, const std::function<void(size_t, size_t)>& body);
+    void advanceEnv(size_t index, uint8_t action, uint8_t* observations);
+    void stepLockstep(const uint8_t* actions, uint8_t* observations);
+    void resetEnv(size_t index);
+    void writeObservation(size_t index, uint8_t* observations) const;
+};
@@ -1,4 +1,7 @@
 #include "cpu.hpp"
+#include "savestate.hpp"
+#include "scheduler.hpp"
+#include "timeline.hpp"
 #include <iostream>
 #include <iomanip>
 
@@ -12,7 +15,7 @@ CPU::CPU(Memory* mem, PPU* ppu)
         PC = 0x0100;   // 実機もここから実行開始
         SP = 0xFFFE;   // スタックポインタ
 
-        std::cout << "[CPU RESET] PC=" << std::hex << PC
+        trace << "[CPU RESET] PC=" << std::hex << PC
                   << " SP=" << SP << std::dec << std::endl;
 
         // 実機の電源投入直後のレジスタ値
@@ -25,7 +28,7 @@ CPU::CPU(Memory* mem, PPU* ppu)
         H = 0x01;
         L = 0x4D;
 
-        std::cout << "CPU reset done.\n";
+        trace << "CPU reset done.\n";
     }
 
 
@@ -56,7 +59,7 @@ int CPU::step() {
         // 0x00: NOP
         case 0x00:
         cycles += 4;
-        std::cout << "NOP\n";
+        trace << "NOP\n";
         break;
 
         // 0x01: LD BC,d16
@@ -67,7 +70,7 @@ int CPU::step() {
             B = hi;
             C = lo;
             cycles += 12;
-            std::cout << "LD BC, " << std::hex << ((hi<<8)|lo) << "\n";
+            trace << "LD BC, " << std::hex << ((hi<<8)|lo) << "\n";
             break;
         }
 
@@ -77,7 +80,7 @@ int CPU::step() {
             uint16_t addr = (B << 8) | C;
             memory->writeByte(addr, A);
             cycles += 8;
-            std::cout << "LD (" << std::hex << addr << "),A=" << (int)A << "\n";
+            trace << "LD (" << std::hex << addr << "),A=" << (int)A << "\n";
             break;
         }
 
@@ -89,7 +92,7 @@ int CPU::step() {
             B = (bc >> 8) & 0xFF;
             C = bc & 0xFF;
             cycles += 8;
-            std::cout << "INC BC → " << std::hex << bc << "\n";
+            trace << "INC BC → " << std::hex << bc << "\n";
             break;
         }
 
@@ -101,7 +104,7 @@ int CPU::step() {
             F &= ~FLAG_N;                  // N=0(加算)
             if ((B & 0x0F) == 0x00) F |= FLAG_H; else F &= ~FLAG_H;
             cycles += 4;
-            std::cout << "INC B → " << std::hex << (int)B << "\n";
+            trace << "INC B → " << std::hex << (int)B << "\n";
             break;
 
         // 0x05: DEC B
@@ -112,7 +115,7 @@ int CPU::step() {
             F |= FLAG_N;                    // 減算なのでN=1
             if ((B & 0x0F) == 0x0F) F |= FLAG_H; else F &= ~FLAG_H;
             cycles += 4;
-            std::cout << "DEC B → " << std::hex << (int)B << "\n";
+            trace << "DEC B → " << std::hex << (int)B << "\n";
             break;
 
         // 0x06: LD B,d8
@@ -121,7 +124,7 @@ int CPU::step() {
             uint8_t val = memory->readByte(PC++);
             B = val;
             cycles += 8;
-            std::cout << "LD B, " << std::hex << (int)val << "\n";
+            trace << "LD B, " << std::hex << (int)val << "\n";
             break;
         }
 
@@ -133,7 +136,7 @@ int CPU::step() {
             F = 0;
             if (carry_out) F |= FLAG_C;
             cycles += 4;
-            std::cout << "RLCA → A=" << std::hex << (int)A
+            trace << "RLCA → A=" << std::hex << (int)A
                         << " C=" << carry_out << "\n";
             break;
         }
@@ -147,7 +150,7 @@ int CPU::step() {
             memory->writeByte(addr, SP & 0xFF);
             memory->writeByte(addr + 1, (SP >> 8) & 0xFF);
             cycles += 20;
-            std::cout << "LD (" << std::hex << addr
+            trace << "LD (" << std::hex << addr
                         << "),SP=" << SP << "\n";
             break;
         }
@@ -167,7 +170,7 @@ int CPU::step() {
             H = (result >> 8) & 0xFF;
             L = result & 0xFF;
             cycles += 8;
-            std::cout << "ADD HL,BC → HL=" << std::hex << (int)result << "\n";
+            trace << "ADD HL,BC → HL=" << std::hex << (int)result << "\n";
             break;
         }
 
@@ -177,7 +180,7 @@ int CPU::step() {
             uint16_t addr = (B << 8) | C;
             A = memory->readByte(addr);
             cycles += 8;
-            std::cout << "LD A,(" << std::hex << addr
+            trace << "LD A,(" << std::hex << addr
                         << ") → A=" << (int)A << "\n";
             break;
         }
@@ -190,7 +193,7 @@ int CPU::step() {
             B = (bc >> 8) & 0xFF;
             C = bc & 0xFF;
             cycles += 8;
-            std::cout << "DEC BC → " << std::hex << bc << "\n";
+            trace << "DEC BC → " << std::hex << bc << "\n";
             break;
         }
 
@@ -202,7 +205,7 @@ int CPU::step() {
             F &= ~FLAG_N;
             if ((C & 0x0F) == 0x00) F |= FLAG_H; else F &= ~FLAG_H;
             cycles += 4;
-            std::cout << "INC C → " << std::hex << (int)C << "\n";
+            trace << "INC C → " << std::hex << (int)C << "\n";
             break;
 
         // 0x0D: DEC C
@@ -213,7 +216,7 @@ int CPU::step() {
             F |= FLAG_N;
             if ((C & 0x0F) == 0x0F) F |= FLAG_H; else F &= ~FLAG_H;
             cycles += 4;
-            std::cout << "DEC C → " << std::hex << (int)C << "\n";
+            trace << "DEC C → " << std::hex << (int)C << "\n";
             break;
 
         // 0x0E: LD C,d8
@@ -222,7 +225,7 @@ int CPU::step() {
             uint8_t val = memory->readByte(PC++);
             C = val;
             cycles += 8;
-            std::cout << "LD C, " << std::hex << (int)val << "\n";
+            trace << "LD C, " << std::hex << (int)val << "\n";
             break;
         }
 
@@ -234,7 +237,7 @@ int CPU::step() {
             F = 0;
             if (carry_out) F |= FLAG_C;
             cycles += 4;
-            std::cout << "RRCA → A=" << std::hex << (int)A
+            trace << "RRCA → A=" << std::hex << (int)A
                         << " C=" << carry_out << "\n";
             break;
         }
@@ -242,7 +245,7 @@ int CPU::step() {
         // 0x10: STOP
         case 0x10:
             cycles += 4;
-            std::cout << "STOP (treated as NOP)\n";
+            trace << "STOP (treated as NOP)\n";
             break;
 
         // 0x11: LD DE,d16
@@ -253,7 +256,7 @@ int CPU::step() {
             D = hi;
             E = lo;
             cycles += 12;
-            std::cout << "LD DE, " << std::hex << ((hi<<8)|lo) << "\n";
+            trace << "LD DE, " << std::hex << ((hi<<8)|lo) << "\n";
             break;
         }
 
@@ -263,7 +266,7 @@ int CPU::step() {
             uint16_t addr = (D << 8) | E;
             memory->writeByte(addr, A);
             cycles += 8;
-            std::cout << "LD (" << std::hex << addr
+            trace << "LD (" << std::hex << addr
                         << "),A=" << (int)A << "\n";
             break;
         }
@@ -276,7 +279,7 @@ int CPU::step() {
             D = (de >> 8) & 0xFF;
             E = de & 0xFF;
             cycles += 8;
-            std::cout << "INC DE → " << std::hex << de << "\n";
+            trace << "INC DE → " << std::hex << de << "\n";
             break;
         }
 
@@ -289,7 +292,7 @@ int CPU::step() {
             F &= ~FLAG_N;                       // 加算なのでN=0
             if ((D & 0x0F) == 0x00) F |= FLAG_H; else F &= ~FLAG_H;
             cycles += 4;
-            std::cout << "INC D → " << std::hex << (int)D << "\n";
+            trace << "INC D → " << std::hex << (int)D << "\n";
             break;
 
         case 0x15:  // DEC D
@@ -299,7 +302,7 @@ int CPU::step() {
             F |= FLAG_N;                        // 減算なのでN=1
             if ((D & 0x0F) == 0x0F) F |= FLAG_H; else F &= ~FLAG_H;
             cycles += 4;
-            std::cout << "DEC D → " << std::hex << (int)D << "\n";
+            trace << "DEC D → " << std::hex << (int)D << "\n";
             break;
 
         case 0x16:  // LD D,d8
@@ -307,7 +310,7 @@ int CPU::step() {
             uint8_t val = memory->readByte(PC++);
             D = val;
             cycles += 8;
-            std::cout << "LD D, " << std::hex << (int)val << "\n";
+            trace << "LD D, " << std::hex << (int)val << "\n";
             break;
         }
 
@@ -319,7 +322,7 @@ int CPU::step() {
             F = 0;
             if (newCarry) F |= FLAG_C;
             cycles += 4;
-            std::cout << "RLA → A=" << std::hex << (int)A
+            trace << "RLA → A=" << std::hex << (int)A
                       << " C=" << newCarry << "\n";
             break;
         }
@@ -331,7 +334,7 @@ int CPU::step() {
 
             PC += offset;
             cycles += 12;
-            std::cout << "JR → " << std::hex << PC << " (offset=" << (int)offset << ")\n";
+            trace << "JR → " << std::hex << PC << " (offset=" << (int)offset << ")\n";
             break;
         }
 
@@ -349,7 +352,7 @@ int CPU::step() {
             H = (result >> 8) & 0xFF;
             L = result & 0xFF;
             cycles += 8;
-            std::cout << "ADD HL,DE → HL=" << std::hex << (int)result << "\n";
+            trace << "ADD HL,DE → HL=" << std::hex << (int)result << "\n";
             break;
         }
 
@@ -358,7 +361,7 @@ int CPU::step() {
             uint16_t addr = (D << 8) | E;
             A = memory->readByte(addr);
             cycles += 8;
-            std::cout << "LD A,(" << std::hex << addr << ") → A=" << (int)A << "\n";
+            trace << "LD A,(" << std::hex << addr << ") → A=" << (int)A << "\n";
             break;
         }
 
@@ -369,7 +372,7 @@ int CPU::step() {
             D = (de >> 8) & 0xFF;
             E = de & 0xFF;
             cycles += 8;
-            std::cout << "DEC DE → " << std::hex << de << "\n";
+            trace << "DEC DE → " << std::hex << de << "\n";
             break;
         }
 
@@ -380,7 +383,7 @@ int CPU::step() {
             F &= ~FLAG_N;
             if ((E & 0x0F) == 0x00) F |= FLAG_H; else F &= ~FLAG_H;
             cycles += 4;
-            std::cout << "INC E → " << std::hex << (int)E << "\n";
+            trace << "INC E → " << std::hex << (int)E << "\n";
             break;
 
         case 0x1D:  // DEC E
@@ -390,7 +393,7 @@ int CPU::step() {
             F |= FLAG_N;
             if ((E & 0x0F) == 0x0F) F |= FLAG_H; else F &= ~FLAG_H;
             cycles += 4;
-            std::cout << "DEC E → " << std::hex << (int)E << "\n";
+            trace << "DEC E → " << std::hex << (int)E << "\n";
             break;
 
         case 0x1E:  // LD E,d8
@@ -398,7 +401,7 @@ int CPU::step() {
             uint8_t val = memory->readByte(PC++);
             E = val;
             cycles += 8;
-            std::cout << "LD E, " << std::hex << (int)val << "\n";
+            trace << "LD E, " << std::hex << (int)val << "\n";
             break;
         }
 
@@ -410,7 +413,7 @@ int CPU::step() {
             F = 0;
             if (newCarry) F |= FLAG_C;
             cycles += 4;
-            std::cout << "RRA → A=" << std::hex << (int)A
+            trace << "RRA → A=" << std::hex << (int)A
                       << " C=" << (int)newCarry << "\n";
             break;
         }
@@ -421,10 +424,10 @@ int CPU::step() {
             if (!(F & FLAG_Z)) {
                 PC += offset;
                 cycles += 12;
-                std::cout << "JR NZ taken → to " << std::hex << PC << "\n";
+                trace << "JR NZ taken → to " << std::hex << PC << "\n";
             } else {
                 cycles += 8;
-                std::cout << "JR NZ not taken (Z=1)\n";
+                trace << "JR NZ not taken (Z=1)\n";
             }
             break;
         }
@@ -435,7 +438,7 @@ int CPU::step() {
             uint8_t hi = memory->readByte(PC++);
             H = hi; L = lo;
             cycles += 12;
-            std::cout << "LD HL, " << std::hex << ((hi<<8)|lo) << "\n";
+            trace << "LD HL, " << std::hex << ((hi<<8)|lo) << "\n";
             break;
         }
 
@@ -446,7 +449,7 @@ int CPU::step() {
             L++;
             if (L == 0) H++;
             cycles += 8;
-            std::cout << "LD (HL+),A → [" << std::hex << addr
+            trace << "LD (HL+),A → [" << std::hex << addr
                       << "]=" << (int)A
                       << " HL→" << ((H<<8)|L) << "\n";
             break;
@@ -459,7 +462,7 @@ int CPU::step() {
             H = (hl >> 8) & 0xFF;
             L = hl & 0xFF;
             cycles += 8;
-            std::cout << "INC HL → " << std::hex << hl << "\n";
+            trace << "INC HL → " << std::hex << hl << "\n";
             break;
         }
 
@@ -470,7 +473,7 @@ int CPU::step() {
             F &= ~FLAG_N;
             if ((H & 0x0F) == 0x00) F |= FLAG_H; else F &= ~FLAG_H;
             cycles += 4;
-            std::cout << "INC H → " << std::hex << (int)H << "\n";
+            trace << "INC H → " << std::hex << (int)H << "\n";
             break;
 
         case 0x25:  // DEC H
@@ -480,7 +483,7 @@ int CPU::step() {
             F |= FLAG_N;
             if ((H & 0x0F) == 0x0F) F |= FLAG_H; else F &= ~FLAG_H;
             cycles += 4;
-            std::cout << "DEC H → " << std::hex << (int)H << "\n";
+            trace << "DEC H → " << std::hex << (int)H << "\n";
             break;
 
         case 0x26:  // LD H,d8
@@ -488,7 +491,7 @@ int CPU::step() {
             uint8_t val = memory->readByte(PC++);
             H = val;
             cycles += 8;
-            std::cout << "LD H, " << std::hex << (int)val << "\n";
+            trace << "LD H, " << std::hex << (int)val << "\n";
             break;
         }
 
@@ -510,7 +513,7 @@ int CPU::step() {
             F &= ~(FLAG_Z | FLAG_H);
             if (A == 0) F |= FLAG_Z;
             cycles += 4;
-            std::cout << "DAA → A=" << std::hex << (int)A << "\n";
+            trace << "DAA → A=" << std::hex << (int)A << "\n";
             break;
         }
         // ----- 0x28〜0x32 -----
@@ -521,10 +524,10 @@ int CPU::step() {
             if (F & FLAG_Z) {
                 PC += offset;
                 cycles += 12;
-                std::cout << "JR Z taken → to " << std::hex << PC << "\n";
+                trace << "JR Z taken → to " << std::hex << PC << "\n";
             } else {
                 cycles += 8;
-                std::cout << "JR Z not taken (Z=0)\n";
+                trace << "JR Z not taken (Z=0)\n";
             }
             break;
         }
@@ -542,7 +545,7 @@ int CPU::step() {
             H = (result >> 8) & 0xFF;
             L = result & 0xFF;
             cycles += 8;
-            std::cout << "ADD HL,HL → HL=" << std::hex << (int)result << "\n";
+            trace << "ADD HL,HL → HL=" << std::hex << (int)result << "\n";
             break;
         }
 
@@ -553,7 +556,7 @@ int CPU::step() {
             L++;
             if (L == 0) H++;              // 桁上がり時にHも加算
             cycles += 8;
-            std::cout << "LD A,(HL+) → A=" << std::hex << (int)A
+            trace << "LD A,(HL+) → A=" << std::hex << (int)A
                       << ", HL→" << ((H<<8)|L) << "\n";
             break;
         }
@@ -565,7 +568,7 @@ int CPU::step() {
             H = (hl >> 8) & 0xFF;
             L = hl & 0xFF;
             cycles += 8;
-            std::cout << "DEC HL → " << std::hex << hl << "\n";
+            trace << "DEC HL → " << std::hex << hl << "\n";
             break;
         }
 
@@ -576,7 +579,7 @@ int CPU::step() {
             F &= ~FLAG_N;
             if ((L & 0x0F) == 0x00) F |= FLAG_H; else F &= ~FLAG_H;
             cycles += 4;
-            std::cout << "INC L → " << std::hex << (int)L << "\n";
+            trace << "INC L → " << std::hex << (int)L << "\n";
             break;
 
         case 0x2D:  // DEC L
@@ -586,7 +589,7 @@ int CPU::step() {
             F |= FLAG_N;
             if ((L & 0x0F) == 0x0F) F |= FLAG_H; else F &= ~FLAG_H;
             cycles += 4;
-            std::cout << "DEC L → " << std::hex << (int)L << "\n";
+            trace << "DEC L → " << std::hex << (int)L << "\n";
             break;
 
         case 0x2E:  // LD L,d8
@@ -594,7 +597,7 @@ int CPU::step() {
             uint8_t val = memory->readByte(PC++);
             L = val;
             cycles += 8;
-            std::cout << "LD L, " << std::hex << (int)val << "\n";
+            trace << "LD L, " << std::hex << (int)val << "\n";
             break;
         }
 
@@ -602,7 +605,7 @@ int CPU::step() {
             A = ~A;
             F |= (FLAG_N | FLAG_H);         // NとHをセット
             cycles += 4;
-            std::cout << "CPL → A=" << std::hex << (int)A << "\n";
+            trace << "CPL → A=" << std::hex << (int)A << "\n";
             break;
 
         case 0x30:  // JR NC,r8
@@ -611,10 +614,10 @@ int CPU::step() {
             if (!(F & FLAG_C)) {
                 PC += offset;
                 cycles += 12;
-                std::cout << "JR NC taken → to " << std::hex << PC << "\n";
+                trace << "JR NC taken → to " << std::hex << PC << "\n";
             } else {
                 cycles += 8;
-                std::cout << "JR NC not taken (C=1)\n";
+                trace << "JR NC not taken (C=1)\n";
             }
             break;
         }
@@ -625,7 +628,7 @@ int CPU::step() {
             uint8_t hi = memory->readByte(PC++);
             SP = (hi << 8) | lo;
             cycles += 12;
-            std::cout << "LD SP, " << std::hex << SP << "\n";
+            trace << "LD SP, " << std::hex << SP << "\n";
             break;
         }
 
@@ -636,7 +639,7 @@ int CPU::step() {
             L--;
             if (L == 0xFF) H--;            // 下位桁が借りてHを減らす
             cycles += 8;
-            std::cout << "LD (HL-),A → [" << std::hex << addr
+            trace << "LD (HL-),A → [" << std::hex << addr
                       << "]=" << (int)A
                       << " HL→" << ((H<<8)|L) << "\n";
             break;
@@ -646,7 +649,7 @@ int CPU::step() {
         case 0x33:  // INC SP
             SP++;
             cycles += 8;
-            std::cout << "INC SP → " << std::hex << SP << "\n";
+            trace << "INC SP → " << std::hex << SP << "\n";
             break;
 
         case 0x34:  // INC (HL)
@@ -662,7 +665,7 @@ int CPU::step() {
             if ((val & 0x0F) == 0x00) F |= FLAG_H; else F &= ~FLAG_H;
 
             cycles += 12;
-            std::cout << "INC (HL) → [" << std::hex << addr
+            trace << "INC (HL) → [" << std::hex << addr
                       << "]=" << (int)val << "\n";
             break;
         }
@@ -680,7 +683,7 @@ int CPU::step() {
             if ((val & 0x0F) == 0x0F) F |= FLAG_H; else F &= ~FLAG_H;
 
             cycles += 12;
-            std::cout << "DEC (HL) → [" << std::hex << addr
+            trace << "DEC (HL) → [" << std::hex << addr
                       << "]=" << (int)val << "\n";
             break;
         }
@@ -691,7 +694,7 @@ int CPU::step() {
             uint16_t addr = (H << 8) | L;
             memory->writeByte(addr, val);
             cycles += 12;
-            std::cout << "LD (HL), " << std::hex << (int)val
+            trace << "LD (HL), " << std::hex << (int)val
                       << " → [" << addr << "]\n";
             break;
         }
@@ -702,7 +705,7 @@ int CPU::step() {
             F &= ~FLAG_H;
             F |= FLAG_C;
             cycles += 4;
-            std::cout << "SCF → F=" << std::hex << (int)F << "\n";
+            trace << "SCF → F=" << std::hex << (int)F << "\n";
             break;
 
         case 0x38:  // JR C,r8
@@ -711,10 +714,10 @@ int CPU::step() {
             if (F & FLAG_C) {
                 PC += offset;
                 cycles += 12;
-                std::cout << "JR C taken → to " << std::hex << PC << "\n";
+                trace << "JR C taken → to " << std::hex << PC << "\n";
             } else {
                 cycles += 8;
-                std::cout << "JR C not taken (C=0)\n";
+                trace << "JR C not taken (C=0)\n";
             }
             break;
         }
@@ -732,7 +735,7 @@ int CPU::step() {
             H = (result >> 8) & 0xFF;
             L = result & 0xFF;
             cycles += 8;
-            std::cout << "ADD HL,SP → HL=" << std::hex << (int)result << "\n";
+            trace << "ADD HL,SP → HL=" << std::hex << (int)result << "\n";
             break;
         }
 
@@ -743,7 +746,7 @@ int CPU::step() {
             L--;
             if (L == 0xFF) H--;
             cycles += 8;
-            std::cout << "LD A,(HL-) → A=" << std::hex << (int)A
+            trace << "LD A,(HL-) → A=" << std::hex << (int)A
                       << ", HL→" << ((H<<8)|L) << "\n";
             break;
         }
@@ -751,7 +754,7 @@ int CPU::step() {
         case 0x3B:  // DEC SP
             SP--;
             cycles += 8;
-            std::cout << "DEC SP → " << std::hex << SP << "\n";
+            trace << "DEC SP → " << std::hex << SP << "\n";
             break;
 
         case 0x3C:  // INC A
@@ -761,7 +764,7 @@ int CPU::step() {
             F &= ~FLAG_N;
             if ((A & 0x0F) == 0x00) F |= FLAG_H; else F &= ~FLAG_H;
             cycles += 4;
-            std::cout << "INC A → A=" << std::hex << (int)A << "\n";
+            trace << "INC A → A=" << std::hex << (int)A << "\n";
             break;
 
         case 0x3D:  // DEC A
@@ -771,7 +774,7 @@ int CPU::step() {
             F |= FLAG_N;
             if ((A & 0x0F) == 0x0F) F |= FLAG_H; else F &= ~FLAG_H;
             cycles += 4;
-            std::cout << "DEC A → A=" << std::hex << (int)A << "\n";
+            trace << "DEC A → A=" << std::hex << (int)A << "\n";
             break;
 
         case 0x3E:  // LD A,d8
@@ -779,7 +782,7 @@ int CPU::step() {
             uint8_t val = memory->readByte(PC++);
             A = val;
             cycles += 8;
-            std::cout << "LD A, " << std::hex << (int)val << "\n";
+            trace << "LD A, " << std::hex << (int)val << "\n";
             break;
         }
 
@@ -788,43 +791,43 @@ int CPU::step() {
             F &= ~FLAG_N;
             F &= ~FLAG_H;
             cycles += 4;
-            std::cout << "CCF → F=" << std::hex << (int)F << "\n";
+            trace << "CCF → F=" << std::hex << (int)F << "\n";
             break;
 
         case 0x40:  // LD B,B
             // 自分自身なので実質何もしない
             cycles += 4;
-            std::cout << "LD B,B → " << std::hex << (int)B << "\n";
+            trace << "LD B,B → " << std::hex << (int)B << "\n";
             break;
 
         case 0x41:  // LD B,C
             B = C;
             cycles += 4;
-            std::cout << "LD B,C → " << std::hex << (int)B << "\n";
+            trace << "LD B,C → " << std::hex << (int)B << "\n";
             break;
 
         case 0x42:  // LD B,D
             B = D;
             cycles += 4;
-            std::cout << "LD B,D → " << std::hex << (int)B << "\n";
+            trace << "LD B,D → " << std::hex << (int)B << "\n";
             break;
 
         case 0x43:  // LD B,E
             B = E;
             cycles += 4;
-            std::cout << "LD B,E → " << std::hex << (int)B << "\n";
+            trace << "LD B,E → " << std::hex << (int)B << "\n";
             break;
 
         case 0x44:  // LD B,H
             B = H;
             cycles += 4;
-            std::cout << "LD B,H → " << std::hex << (int)B << "\n";
+            trace << "LD B,H → " << std::hex << (int)B << "\n";
             break;
 
         case 0x45:  // LD B,L
             B = L;
             cycles += 4;
-            std::cout << "LD B,L → " << std::hex << (int)B << "\n";
+            trace << "LD B,L → " << std::hex << (int)B << "\n";
             break;
 
         case 0x46:  // LD B,(HL)
@@ -832,50 +835,50 @@ int CPU::step() {
             uint16_t addr = (H << 8) | L;
             B = memory->readByte(addr);
             cycles += 8;
-            std::cout << "LD B,(HL) → " << std::hex << (int)B << "\n";
+            trace << "LD B,(HL) → " << std::hex << (int)B << "\n";
             break;
         }
 
         case 0x47:  // LD B,A
             B = A;
             cycles += 4;
-            std::cout << "LD B,A → " << std::hex << (int)B << "\n";
+            trace << "LD B,A → " << std::hex << (int)B << "\n";
             break;
 
         case 0x48:  // LD C,B
             C = B;
             cycles += 4;
-            std::cout << "LD C,B → " << std::hex << (int)C << "\n";
+            trace << "LD C,B → " << std::hex << (int)C << "\n";
             break;
 
         case 0x49:  // LD C,C
             // 自分自身なので何もしない
             cycles += 4;
-            std::cout << "LD C,C → " << std::hex << (int)C << "\n";
+            trace << "LD C,C → " << std::hex << (int)C << "\n";
             break;
 
         case 0x4A:  // LD C,D
             C = D;
             cycles += 4;
-            std::cout << "LD C,D → " << std::hex << (int)C << "\n";
+            trace << "LD C,D → " << std::hex << (int)C << "\n";
             break;
 
         case 0x4B:  // LD C,E
             C = E;
             cycles += 4;
-            std::cout << "LD C,E → " << std::hex << (int)C << "\n";
+            trace << "LD C,E → " << std::hex << (int)C << "\n";
             break;
 
         case 0x4C:  // LD C,H
             C = H;
             cycles += 4;
-            std::cout << "LD C,H → " << std::hex << (int)C << "\n";
+            trace << "LD C,H → " << std::hex << (int)C << "\n";
             break;
 
         case 0x4D:  // LD C,L
             C = L;
             cycles += 4;
-            std::cout << "LD C,L → " << std::hex << (int)C << "\n";
+            trace << "LD C,L → " << std::hex << (int)C << "\n";
             break;
 
         case 0x4E:  // LD C,(HL)
@@ -883,51 +886,51 @@ int CPU::step() {
             uint16_t addr = (H << 8) | L;
             C = memory->readByte(addr);
             cycles += 8;
-            std::cout << "LD C,(HL) → " << std::hex << (int)C << "\n";
+            trace << "LD C,(HL) → " << std::hex << (int)C << "\n";
             break;
         }
 
         case 0x4F:  // LD C,A
             C = A;
             cycles += 4;
-            std::cout << "LD C,A → " << std::hex << (int)C << "\n";
+            trace << "LD C,A → " << std::hex << (int)C << "\n";
             break;
 
         case 0x50:  // LD D,B
             D = B;
             cycles += 4;
-            std::cout << "LD D,B → " << std::hex << (int)D << "\n";
+            trace << "LD D,B → " << std::hex << (int)D << "\n";
             break;
         // ----- 0x51〜0x7F -----
 
         case 0x51:  // LD D,C
             D = C;
             cycles += 4;
-            std::cout << "LD D,C → " << std::hex << (int)D << "\n";
+            trace << "LD D,C → " << std::hex << (int)D << "\n";
             break;
 
         case 0x52:  // LD D,D
             // 自分自身なので変化なし
             cycles += 4;
-            std::cout << "LD D,D → " << std::hex << (int)D << "\n";
+            trace << "LD D,D → " << std::hex << (int)D << "\n";
             break;
 
         case 0x53:  // LD D,E
             D = E;
             cycles += 4;
-            std::cout << "LD D,E → " << std::hex << (int)D << "\n";
+            trace << "LD D,E → " << std::hex << (int)D << "\n";
             break;
 
         case 0x54:  // LD D,H
             D = H;
             cycles += 4;
-            std::cout << "LD D,H → " << std::hex << (int)D << "\n";
+            trace << "LD D,H → " << std::hex << (int)D << "\n";
             break;
 
         case 0x55:  // LD D,L
             D = L;
             cycles += 4;
-            std::cout << "LD D,L → " << std::hex << (int)D << "\n";
+            trace << "LD D,L → " << std::hex << (int)D << "\n";
             break;
 
         case 0x56:  // LD D,(HL)
@@ -935,49 +938,49 @@ int CPU::step() {
             uint16_t addr = (H << 8) | L;
             D = memory->readByte(addr);
             cycles += 8;
-            std::cout << "LD D,(HL) → " << std::hex << (int)D << "\n";
+            trace << "LD D,(HL) → " << std::hex << (int)D << "\n";
             break;
         }
 
         case 0x57:  // LD D,A
             D = A;
             cycles += 4;
-            std::cout << "LD D,A → " << std::hex << (int)D << "\n";
+            trace << "LD D,A → " << std::hex << (int)D << "\n";
             break;
 
         case 0x58:  // LD E,B
             E = B;
             cycles += 4;
-            std::cout << "LD E,B → " << std::hex << (int)E << "\n";
+            trace << "LD E,B → " << std::hex << (int)E << "\n";
             break;
 
         case 0x59:  // LD E,C
             E = C;
             cycles += 4;
-            std::cout << "LD E,C → " << std::hex << (int)E << "\n";
+            trace << "LD E,C → " << std::hex << (int)E << "\n";
             break;
 
         case 0x5A:  // LD E,D
             E = D;
             cycles += 4;
-            std::cout << "LD E,D → " << std::hex << (int)E << "\n";
+            trace << "LD E,D → " << std::hex << (int)E << "\n";
             break;
 
         case 0x5B:  // LD E,E
             cycles += 4;
-            std::cout << "LD E,E → " << std::hex << (int)E << "\n";
+            trace << "LD E,E → " << std::hex << (int)E << "\n";
             break;
 
         case 0x5C:  // LD E,H
             E = H;
             cycles += 4;
-            std::cout << "LD E,H → " << std::hex << (int)E << "\n";
+            trace << "LD E,H → " << std::hex << (int)E << "\n";
             break;
 
         case 0x5D:  // LD E,L
             E = L;
             cycles += 4;
-            std::cout << "LD E,L → " << std::hex << (int)E << "\n";
+            trace << "LD E,L → " << std::hex << (int)E << "\n";
             break;
 
         case 0x5E:  // LD E,(HL)
@@ -985,49 +988,49 @@ int CPU::step() {
             uint16_t addr = (H << 8) | L;
             E = memory->readByte(addr);
             cycles += 8;
-            std::cout << "LD E,(HL) → " << std::hex << (int)E << "\n";
+            trace << "LD E,(HL) → " << std::hex << (int)E << "\n";
             break;
         }
 
         case 0x5F:  // LD E,A
             E = A;
             cycles += 4;
-            std::cout << "LD E,A → " << std::hex << (int)E << "\n";
+            trace << "LD E,A → " << std::hex << (int)E << "\n";
             break;
 
         case 0x60:  // LD H,B
             H = B;
             cycles += 4;
-            std::cout << "LD H,B → " << std::hex << (int)H << "\n";
+            trace << "LD H,B → " << std::hex << (int)H << "\n";
             break;
 
         case 0x61:  // LD H,C
             H = C;
             cycles += 4;
-            std::cout << "LD H,C → " << std::hex << (int)H << "\n";
+            trace << "LD H,C → " << std::hex << (int)H << "\n";
             break;
 
         case 0x62:  // LD H,D
             H = D;
             cycles += 4;
-            std::cout << "LD H,D → " << std::hex << (int)H << "\n";
+            trace << "LD H,D → " << std::hex << (int)H << "\n";
             break;
 
         case 0x63:  // LD H,E
             H = E;
             cycles += 4;
-            std::cout << "LD H,E → " << std::hex << (int)H << "\n";
+            trace << "LD H,E → " << std::hex << (int)H << "\n";
             break;
 
         case 0x64:  // LD H,H
             cycles += 4;
-            std::cout << "LD H,H → " << std::hex << (int)H << "\n";
+            trace << "LD H,H → " << std::hex << (int)H << "\n";
             break;
 
         case 0x65:  // LD H,L
             H = L;
             cycles += 4;
-            std::cout << "LD H,L → " << std::hex << (int)H << "\n";
+            trace << "LD H,L → " << std::hex << (int)H << "\n";
             break;
 
         case 0x66:  // LD H,(HL)
@@ -1035,49 +1038,49 @@ int CPU::step() {
             uint16_t addr = (H << 8) | L;
             H = memory->readByte(addr);
             cycles += 8;
-            std::cout << "LD H,(HL) → " << std::hex << (int)H << "\n";
+            trace << "LD H,(HL) → " << std::hex << (int)H << "\n";
             break;
         }
 
         case 0x67:  // LD H,A
             H = A;
             cycles += 4;
-            std::cout << "LD H,A → " << std::hex << (int)H << "\n";
+            trace << "LD H,A → " << std::hex << (int)H << "\n";
             break;
 
         case 0x68:  // LD L,B
             L = B;
             cycles += 4;
-            std::cout << "LD L,B → " << std::hex << (int)L << "\n";
+            trace << "LD L,B → " << std::hex << (int)L << "\n";
             break;
 
         case 0x69:  // LD L,C
             L = C;
             cycles += 4;
-            std::cout << "LD L,C → " << std::hex << (int)L << "\n";
+            trace << "LD L,C → " << std::hex << (int)L << "\n";
             break;
 
         case 0x6A:  // LD L,D
             L = D;
             cycles += 4;
-            std::cout << "LD L,D → " << std::hex << (int)L << "\n";
+            trace << "LD L,D → " << std::hex << (int)L << "\n";
             break;
 
         case 0x6B:  // LD L,E
             L = E;
             cycles += 4;
-            std::cout << "LD L,E → " << std::hex << (int)L << "\n";
+            trace << "LD L,E → " << std::hex << (int)L << "\n";
             break;
 
         case 0x6C:  // LD L,H
             L = H;
             cycles += 4;
-            std::cout << "LD L,H → " << std::hex << (int)L << "\n";
+            trace << "LD L,H → " << std::hex << (int)L << "\n";
             break;
 
         case 0x6D:  // LD L,L
             cycles += 4;
-            std::cout << "LD L,L → " << std::hex << (int)L << "\n";
+            trace << "LD L,L → " << std::hex << (int)L << "\n";
             break;
 
         case 0x6E:  // LD L,(HL)
@@ -1085,14 +1088,14 @@ int CPU::step() {
             uint16_t addr = (H << 8) | L;
             L = memory->readByte(addr);
             cycles += 8;
-            std::cout << "LD L,(HL) → " << std::hex << (int)L << "\n";
+            trace << "LD L,(HL) → " << std::hex << (int)L << "\n";
             break;
         }
 
         case 0x6F:  // LD L,A
             L = A;
             cycles += 4;
-            std::cout << "LD L,A → " << std::hex << (int)L << "\n";
+            trace << "LD L,A → " << std::hex << (int)L << "\n";
             break;
 
         // ---- Aレジスタとのロード ----
@@ -1101,7 +1104,7 @@ int CPU::step() {
             uint16_t addr = (H << 8) | L;
             memory->writeByte(addr, B);
             cycles += 8;
-            std::cout << "LD (HL),B → [" << std::hex << addr << "]=" << (int)B << "\n";
+            trace << "LD (HL),B → [" << std::hex << addr << "]=" << (int)B << "\n";
             break;
         }
 
@@ -1110,7 +1113,7 @@ int CPU::step() {
             uint16_t addr = (H << 8) | L;
             memory->writeByte(addr, C);
             cycles += 8;
-            std::cout << "LD (HL),C → [" << std::hex << addr << "]=" << (int)C << "\n";
+            trace << "LD (HL),C → [" << std::hex << addr << "]=" << (int)C << "\n";
             break;
         }
 
@@ -1119,7 +1122,7 @@ int CPU::step() {
             uint16_t addr = (H << 8) | L;
             memory->writeByte(addr, D);
             cycles += 8;
-            std::cout << "LD (HL),D → [" << std::hex << addr << "]=" << (int)D << "\n";
+            trace << "LD (HL),D → [" << std::hex << addr << "]=" << (int)D << "\n";
             break;
         }
 
@@ -1128,7 +1131,7 @@ int CPU::step() {
             uint16_t addr = (H << 8) | L;
             memory->writeByte(addr, E);
             cycles += 8;
-            std::cout << "LD (HL),E → [" << std::hex << addr << "]=" << (int)E << "\n";
+            trace << "LD (HL),E → [" << std::hex << addr << "]=" << (int)E << "\n";
             break;
         }
 
@@ -1137,7 +1140,7 @@ int CPU::step() {
             uint16_t addr = (H << 8) | L;
             memory->writeByte(addr, H);
             cycles += 8;
-            std::cout << "LD (HL),H → [" << std::hex << addr << "]=" << (int)H << "\n";
+            trace << "LD (HL),H → [" << std::hex << addr << "]=" << (int)H << "\n";
             break;
         }
 
@@ -1146,14 +1149,14 @@ int CPU::step() {
             uint16_t addr = (H << 8) | L;
             memory->writeByte(addr, L);
             cycles += 8;
-            std::cout << "LD (HL),L → [" << std::hex << addr << "]=" << (int)L << "\n";
+            trace << "LD (HL),L → [" << std::hex << addr << "]=" << (int)L << "\n";
             break;
         }
 
         case 0x76:  // HALT
             halted = true;
             cycles += 4;
-            std::cout << "HALT\n";
+            trace << "HALT\n";
             break;
 
         case 0x77:  // LD (HL),A
@@ -1161,7 +1164,7 @@ int CPU::step() {
             uint16_t addr = (H << 8) | L;
             memory->writeByte(addr, A);
             cycles += 8;
-            std::cout << "LD (HL),A → [" << std::hex << addr << "]=" << (int)A << "\n";
+            trace << "LD (HL),A → [" << std::hex << addr << "]=" << (int)A << "\n";
             break;
         }
 
@@ -1169,37 +1172,37 @@ int CPU::step() {
         case 0x78:  // LD A,B
             A = B;
             cycles += 4;
-            std::cout << "LD A,B → " << std::hex << (int)A << "\n";
+            trace << "LD A,B → " << std::hex << (int)A << "\n";
             break;
 
         case 0x79:  // LD A,C
             A = C;
             cycles += 4;
-            std::cout << "LD A,C → " << std::hex << (int)A << "\n";
+            trace << "LD A,C → " << std::hex << (int)A << "\n";
             break;
 
         case 0x7A:  // LD A,D
             A = D;
             cycles += 4;
-            std::cout << "LD A,D → " << std::hex << (int)A << "\n";
+            trace << "LD A,D → " << std::hex << (int)A << "\n";
             break;
 
         case 0x7B:  // LD A,E
             A = E;
             cycles += 4;
-            std::cout << "LD A,E → " << std::hex << (int)A << "\n";
+            trace << "LD A,E → " << std::hex << (int)A << "\n";
             break;
 
         case 0x7C:  // LD A,H
             A = H;
             cycles += 4;
-            std::cout << "LD A,H → " << std::hex << (int)A << "\n";
+            trace << "LD A,H → " << std::hex << (int)A << "\n";
             break;
 
         case 0x7D:  // LD A,L
             A = L;
             cycles += 4;
-            std::cout << "LD A,L → " << std::hex << (int)A << "\n";
+            trace << "LD A,L → " << std::hex << (int)A << "\n";
             break;
 
         case 0x7E:  // LD A,(HL)
@@ -1207,13 +1210,13 @@ int CPU::step() {
             uint16_t addr = (H << 8) | L;
             A = memory->readByte(addr);
             cycles += 8;
-            std::cout << "LD A,(HL) → A=" << std::hex << (int)A << "\n";
+            trace << "LD A,(HL) → A=" << std::hex << (int)A << "\n";
             break;
         }
 
         case 0x7F:  // LD A,A
             cycles += 4;
-            std::cout << "LD A,A → " << std::hex << (int)A << "\n";
+            trace << "LD A,A → " << std::hex << (int)A << "\n";
             break;
         // ----- 0x80〜0x8F : ADD A,r -----
         case 0x80:  // ADD A,B
@@ -1225,7 +1228,7 @@ int CPU::step() {
             if (result > 0xFF) F |= FLAG_C;
             A = result & 0xFF;
             cycles += 4;
-            std::cout << "ADD A,B → A=" << std::hex << (int)A << "\n";
+            trace << "ADD A,B → A=" << std::hex << (int)A << "\n";
             break;
         }
 
@@ -1238,7 +1241,7 @@ int CPU::step() {
             if (result > 0xFF) F |= FLAG_C;
             A = result & 0xFF;
             cycles += 4;
-            std::cout << "ADD A,C → A=" << std::hex << (int)A << "\n";
+            trace << "ADD A,C → A=" << std::hex << (int)A << "\n";
             break;
         }
 
@@ -1251,7 +1254,7 @@ int CPU::step() {
             if (result > 0xFF) F |= FLAG_C;
             A = result & 0xFF;
             cycles += 4;
-            std::cout << "ADD A,D → A=" << std::hex << (int)A << "\n";
+            trace << "ADD A,D → A=" << std::hex << (int)A << "\n";
             break;
         }
 
@@ -1264,7 +1267,7 @@ int CPU::step() {
             if (result > 0xFF) F |= FLAG_C;
             A = result & 0xFF;
             cycles += 4;
-            std::cout << "ADD A,E → A=" << std::hex << (int)A << "\n";
+            trace << "ADD A,E → A=" << std::hex << (int)A << "\n";
             break;
         }
 
@@ -1277,7 +1280,7 @@ int CPU::step() {
             if (result > 0xFF) F |= FLAG_C;
             A = result & 0xFF;
             cycles += 4;
-            std::cout << "ADD A,H → A=" << std::hex << (int)A << "\n";
+            trace << "ADD A,H → A=" << std::hex << (int)A << "\n";
             break;
         }
 
@@ -1290,7 +1293,7 @@ int CPU::step() {
             if (result > 0xFF) F |= FLAG_C;
             A = result & 0xFF;
             cycles += 4;
-            std::cout << "ADD A,L → A=" << std::hex << (int)A << "\n";
+            trace << "ADD A,L → A=" << std::hex << (int)A << "\n";
             break;
         }
 
@@ -1304,7 +1307,7 @@ int CPU::step() {
             if (result > 0xFF) F |= FLAG_C;
             A = result & 0xFF;
             cycles += 8;
-            std::cout << "ADD A,(HL) → A=" << std::hex << (int)A << "\n";
+            trace << "ADD A,(HL) → A=" << std::hex << (int)A << "\n";
             break;
         }
 
@@ -1317,7 +1320,7 @@ int CPU::step() {
             if (result > 0xFF) F |= FLAG_C;
             A = result & 0xFF;
             cycles += 4;
-            std::cout << "ADD A,A → A=" << std::hex << (int)A << "\n";
+            trace << "ADD A,A → A=" << std::hex << (int)A << "\n";
             break;
         }
         /* =========================
@@ -1332,7 +1335,7 @@ int CPU::step() {
             if (r > 0xFF) F |= FLAG_C;
             A = (uint8_t)r;
             cycles += 4;
-            std::cout << "ADC A,B → A=" << std::hex << (int)A << "\n";
+            trace << "ADC A,B → A=" << std::hex << (int)A << "\n";
             break;
         }
         case 0x89: { // ADC A,C
@@ -1344,7 +1347,7 @@ int CPU::step() {
             if (r > 0xFF) F |= FLAG_C;
             A = (uint8_t)r;
             cycles += 4;
-            std::cout << "ADC A,C → A=" << std::hex << (int)A << "\n";
+            trace << "ADC A,C → A=" << std::hex << (int)A << "\n";
             break;
         }
         case 0x8A: { // ADC A,D
@@ -1356,7 +1359,7 @@ int CPU::step() {
             if (r > 0xFF) F |= FLAG_C;
             A = (uint8_t)r;
             cycles += 4;
-            std::cout << "ADC A,D → A=" << std::hex << (int)A << "\n";
+            trace << "ADC A,D → A=" << std::hex << (int)A << "\n";
             break;
         }
         case 0x8B: { // ADC A,E
@@ -1368,7 +1371,7 @@ int CPU::step() {
             if (r > 0xFF) F |= FLAG_C;
             A = (uint8_t)r;
             cycles += 4;
-            std::cout << "ADC A,E → A=" << std::hex << (int)A << "\n";
+            trace << "ADC A,E → A=" << std::hex << (int)A << "\n";
             break;
         }
         case 0x8C: { // ADC A,H
@@ -1380,7 +1383,7 @@ int CPU::step() {
             if (r > 0xFF) F |= FLAG_C;
             A = (uint8_t)r;
             cycles += 4;
-            std::cout << "ADC A,H → A=" << std::hex << (int)A << "\n";
+            trace << "ADC A,H → A=" << std::hex << (int)A << "\n";
             break;
         }
         case 0x8D: { // ADC A,L
@@ -1392,7 +1395,7 @@ int CPU::step() {
             if (r > 0xFF) F |= FLAG_C;
             A = (uint8_t)r;
             cycles += 4;
-            std::cout << "ADC A,L → A=" << std::hex << (int)A << "\n";
+            trace << "ADC A,L → A=" << std::hex << (int)A << "\n";
             break;
         }
         case 0x8E: { // ADC A,(HL)
@@ -1405,7 +1408,7 @@ int CPU::step() {
             if (r > 0xFF) F |= FLAG_C;
             A = (uint8_t)r;
             cycles += 8;
-            std::cout << "ADC A,(HL) → A=" << std::hex << (int)A << "\n";
+            trace << "ADC A,(HL) → A=" << std::hex << (int)A << "\n";
             break;
         }
         case 0x8F: { // ADC A,A
@@ -1417,7 +1420,7 @@ int CPU::step() {
             if (r > 0xFF) F |= FLAG_C;
             A = (uint8_t)r;
             cycles += 4;
-            std::cout << "ADC A,A → A=" << std::hex << (int)A << "\n";
+            trace << "ADC A,A → A=" << std::hex << (int)A << "\n";
             break;
         }
 
@@ -1431,7 +1434,7 @@ int CPU::step() {
             if (A < B) F |= FLAG_C;
             A = result & 0xFF;
             cycles += 4;
-            std::cout << "SUB B → A=" << std::hex << (int)A << "\n";
+            trace << "SUB B → A=" << std::hex << (int)A << "\n";
             break;
         }
 
@@ -1444,7 +1447,7 @@ int CPU::step() {
             if (A < C) F |= FLAG_C;
             A = result & 0xFF;
             cycles += 4;
-            std::cout << "SUB C → A=" << std::hex << (int)A << "\n";
+            trace << "SUB C → A=" << std::hex << (int)A << "\n";
             break;
         }
         case 0x92: { // SUB D
@@ -1455,7 +1458,7 @@ int CPU::step() {
             if (A < D) F |= FLAG_C;
             A = (uint8_t)r;
             cycles += 4;
-            std::cout << "SUB D → A=" << std::hex << (int)A << "\n";
+            trace << "SUB D → A=" << std::hex << (int)A << "\n";
             break;
         }
         case 0x93: { // SUB E
@@ -1466,7 +1469,7 @@ int CPU::step() {
             if (A < E) F |= FLAG_C;
             A = (uint8_t)r;
             cycles += 4;
-            std::cout << "SUB E → A=" << std::hex << (int)A << "\n";
+            trace << "SUB E → A=" << std::hex << (int)A << "\n";
             break;
         }
         case 0x94: { // SUB H
@@ -1477,7 +1480,7 @@ int CPU::step() {
             if (A < H) F |= FLAG_C;
             A = (uint8_t)r;
             cycles += 4;
-            std::cout << "SUB H → A=" << std::hex << (int)A << "\n";
+            trace << "SUB H → A=" << std::hex << (int)A << "\n";
             break;
         }
         case 0x95: { // SUB L
@@ -1488,7 +1491,7 @@ int CPU::step() {
             if (A < L) F |= FLAG_C;
             A = (uint8_t)r;
             cycles += 4;
-            std::cout << "SUB L → A=" << std::hex << (int)A << "\n";
+            trace << "SUB L → A=" << std::hex << (int)A << "\n";
             break;
         }
         case 0x96: { // SUB (HL)
@@ -1500,7 +1503,7 @@ int CPU::step() {
             if (A < v) F |= FLAG_C;
             A = (uint8_t)r;
             cycles += 8;
-            std::cout << "SUB (HL) → A=" << std::hex << (int)A << "\n";
+            trace << "SUB (HL) → A=" << std::hex << (int)A << "\n";
             break;
         }
         case 0x97: { // SUB A
@@ -1508,7 +1511,7 @@ int CPU::step() {
             F = FLAG_N | FLAG_Z; // Z=1, H=0, C=0
             A = 0;
             cycles += 4;
-            std::cout << "SUB A → A=0\n";
+            trace << "SUB A → A=0\n";
             break;
         }
 
@@ -1524,7 +1527,7 @@ int CPU::step() {
             if (A < (uint16_t)B + c) F |= FLAG_C;
             A = (uint8_t)r;
             cycles += 4;
-            std::cout << "SBC A,B → A=" << std::hex << (int)A << "\n";
+            trace << "SBC A,B → A=" << std::hex << (int)A << "\n";
             break;
         }
         case 0x99: { // SBC A,C
@@ -1536,7 +1539,7 @@ int CPU::step() {
             if (A < (uint16_t)C + c) F |= FLAG_C;
             A = (uint8_t)r;
             cycles += 4;
-            std::cout << "SBC A,C → A=" << std::hex << (int)A << "\n";
+            trace << "SBC A,C → A=" << std::hex << (int)A << "\n";
             break;
         }
         case 0x9A: { // SBC A,D
@@ -1548,7 +1551,7 @@ int CPU::step() {
             if (A < (uint16_t)D + c) F |= FLAG_C;
             A = (uint8_t)r;
             cycles += 4;
-            std::cout << "SBC A,D → A=" << std::hex << (int)A << "\n";
+            trace << "SBC A,D → A=" << std::hex << (int)A << "\n";
             break;
         }
         case 0x9B: { // SBC A,E
@@ -1560,7 +1563,7 @@ int CPU::step() {
             if (A < (uint16_t)E + c) F |= FLAG_C;
             A = (uint8_t)r;
             cycles += 4;
-            std::cout << "SBC A,E → A=" << std::hex << (int)A << "\n";
+            trace << "SBC A,E → A=" << std::hex << (int)A << "\n";
             break;
         }
         case 0x9C: { // SBC A,H
@@ -1572,7 +1575,7 @@ int CPU::step() {
             if (A < (uint16_t)H + c) F |= FLAG_C;
             A = (uint8_t)r;
             cycles += 4;
-            std::cout << "SBC A,H → A=" << std::hex << (int)A << "\n";
+            trace << "SBC A,H → A=" << std::hex << (int)A << "\n";
             break;
         }
         case 0x9D: { // SBC A,L
@@ -1584,7 +1587,7 @@ int CPU::step() {
             if (A < (uint16_t)L + c) F |= FLAG_C;
             A = (uint8_t)r;
             cycles += 4;
-            std::cout << "SBC A,L → A=" << std::hex << (int)A << "\n";
+            trace << "SBC A,L → A=" << std::hex << (int)A << "\n";
             break;
         }
         case 0x9E: { // SBC A,(HL)
@@ -1597,7 +1600,7 @@ int CPU::step() {
             if (A < (uint16_t)v + c) F |= FLAG_C;
             A = (uint8_t)r;
             cycles += 8;
-            std::cout << "SBC A,(HL) → A=" << std::hex << (int)A << "\n";
+            trace << "SBC A,(HL) → A=" << std::hex << (int)A << "\n";
             break;
         }
         case 0x9F: { // SBC A,A
@@ -1609,7 +1612,7 @@ int CPU::step() {
             if (A < (uint16_t)A + c) F |= FLAG_C; // ⇔ c==1
             A = (uint8_t)r; // 0 or 0xFF
             cycles += 4;
-            std::cout << "SBC A,A → A=" << std::hex << (int)A << "\n";
+            trace << "SBC A,A → A=" << std::hex << (int)A << "\n";
             break;
         }
 
@@ -1624,7 +1627,7 @@ int CPU::step() {
             if (A == 0) F |= FLAG_Z;
             F |= FLAG_H;
             cycles += 4;
-            std::cout << "AND B → A=" << std::hex << (int)A << "\n";
+            trace << "AND B → A=" << std::hex << (int)A << "\n";
             break;
 
         case 0xA1:  // AND C
@@ -1633,7 +1636,7 @@ int CPU::step() {
             if (A == 0) F |= FLAG_Z;
             F |= FLAG_H;
             cycles += 4;
-            std::cout << "AND C → A=" << std::hex << (int)A << "\n";
+            trace << "AND C → A=" << std::hex << (int)A << "\n";
             break;
 
         case 0xA2:  // AND D
@@ -1642,7 +1645,7 @@ int CPU::step() {
             if (A == 0) F |= FLAG_Z;
             F |= FLAG_H;
             cycles += 4;
-            std::cout << "AND D → A=" << std::hex << (int)A << "\n";
+            trace << "AND D → A=" << std::hex << (int)A << "\n";
             break;
 
         case 0xA3:  // AND E
@@ -1651,7 +1654,7 @@ int CPU::step() {
             if (A == 0) F |= FLAG_Z;
             F |= FLAG_H;
             cycles += 4;
-            std::cout << "AND E → A=" << std::hex << (int)A << "\n";
+            trace << "AND E → A=" << std::hex << (int)A << "\n";
             break;
 
         case 0xA4:  // AND H
@@ -1660,7 +1663,7 @@ int CPU::step() {
             if (A == 0) F |= FLAG_Z;
             F |= FLAG_H;
             cycles += 4;
-            std::cout << "AND H → A=" << std::hex << (int)A << "\n";
+            trace << "AND H → A=" << std::hex << (int)A << "\n";
             break;
 
         case 0xA5:  // AND L
@@ -1669,7 +1672,7 @@ int CPU::step() {
             if (A == 0) F |= FLAG_Z;
             F |= FLAG_H;
             cycles += 4;
-            std::cout << "AND L → A=" << std::hex << (int)A << "\n";
+            trace << "AND L → A=" << std::hex << (int)A << "\n";
             break;
 
         case 0xA6:  // AND (HL)
@@ -1680,7 +1683,7 @@ int CPU::step() {
             if (A == 0) F |= FLAG_Z;
             F |= FLAG_H;
             cycles += 8;
-            std::cout << "AND (HL) → A=" << std::hex << (int)A << "\n";
+            trace << "AND (HL) → A=" << std::hex << (int)A << "\n";
             break;
         }
 
@@ -1689,7 +1692,7 @@ int CPU::step() {
             if (A == 0) F |= FLAG_Z;
             F |= FLAG_H;
             cycles += 4;
-            std::cout << "AND A → A=" << std::hex << (int)A << "\n";
+            trace << "AND A → A=" << std::hex << (int)A << "\n";
             break;
 
         case 0xA8:  // XOR B
@@ -1697,7 +1700,7 @@ int CPU::step() {
             F = 0;
             if (A == 0) F |= FLAG_Z;
             cycles += 4;
-            std::cout << "XOR B → A=" << std::hex << (int)A << "\n";
+            trace << "XOR B → A=" << std::hex << (int)A << "\n";
             break;
 
         case 0xA9:  // XOR C
@@ -1705,7 +1708,7 @@ int CPU::step() {
             F = 0;
             if (A == 0) F |= FLAG_Z;
             cycles += 4;
-            std::cout << "XOR C → A=" << std::hex << (int)A << "\n";
+            trace << "XOR C → A=" << std::hex << (int)A << "\n";
             break;
 
         case 0xAA:  // XOR D
@@ -1713,7 +1716,7 @@ int CPU::step() {
             F = 0;
             if (A == 0) F |= FLAG_Z;
             cycles += 4;
-            std::cout << "XOR D → A=" << std::hex << (int)A << "\n";
+            trace << "XOR D → A=" << std::hex << (int)A << "\n";
             break;
 
         case 0xAB:  // XOR E
@@ -1721,7 +1724,7 @@ int CPU::step() {
             F = 0;
             if (A == 0) F |= FLAG_Z;
             cycles += 4;
-            std::cout << "XOR E → A=" << std::hex << (int)A << "\n";
+            trace << "XOR E → A=" << std::hex << (int)A << "\n";
             break;
 
         case 0xAC:  // XOR H
@@ -1729,7 +1732,7 @@ int CPU::step() {
             F = 0;
             if (A == 0) F |= FLAG_Z;
             cycles += 4;
-            std::cout << "XOR H → A=" << std::hex << (int)A << "\n";
+            trace << "XOR H → A=" << std::hex << (int)A << "\n";
             break;
 
         case 0xAD:  // XOR L
@@ -1737,7 +1740,7 @@ int CPU::step() {
             F = 0;
             if (A == 0) F |= FLAG_Z;
             cycles += 4;
-            std::cout << "XOR L → A=" << std::hex << (int)A << "\n";
+            trace << "XOR L → A=" << std::hex << (int)A << "\n";
             break;
 
         case 0xAE:  // XOR (HL)
@@ -1747,7 +1750,7 @@ int CPU::step() {
             F = 0;
             if (A == 0) F |= FLAG_Z;
             cycles += 8;
-            std::cout << "XOR (HL) → A=" << std::hex << (int)A << "\n";
+            trace << "XOR (HL) → A=" << std::hex << (int)A << "\n";
             break;
         }
 
@@ -1755,7 +1758,7 @@ int CPU::step() {
             A = 0;
             F = FLAG_Z;
             cycles += 4;
-            std::cout << "XOR A → A=0\n";
+            trace << "XOR A → A=0\n";
             break;
 
         // ----- 0xB0〜0xBF : OR/CP -----
@@ -1764,7 +1767,7 @@ int CPU::step() {
             F = 0;
             if (A == 0) F |= FLAG_Z;
             cycles += 4;
-            std::cout << "OR B → A=" << std::hex << (int)A << "\n";
+            trace << "OR B → A=" << std::hex << (int)A << "\n";
             break;
 
         case 0xB1:  // OR C
@@ -1772,7 +1775,7 @@ int CPU::step() {
             F = 0;
             if (A == 0) F |= FLAG_Z;
             cycles += 4;
-            std::cout << "OR C → A=" << std::hex << (int)A << "\n";
+            trace << "OR C → A=" << std::hex << (int)A << "\n";
             break;
 
         case 0xB2:  // OR D
@@ -1780,7 +1783,7 @@ int CPU::step() {
             F = 0;
             if (A == 0) F |= FLAG_Z;
             cycles += 4;
-            std::cout << "OR D → A=" << std::hex << (int)A << "\n";
+            trace << "OR D → A=" << std::hex << (int)A << "\n";
             break;
 
         case 0xB3:  // OR E
@@ -1788,7 +1791,7 @@ int CPU::step() {
             F = 0;
             if (A == 0) F |= FLAG_Z;
             cycles += 4;
-            std::cout << "OR E → A=" << std::hex << (int)A << "\n";
+            trace << "OR E → A=" << std::hex << (int)A << "\n";
             break;
 
         case 0xB4:  // OR H
@@ -1796,7 +1799,7 @@ int CPU::step() {
             F = 0;
             if (A == 0) F |= FLAG_Z;
             cycles += 4;
-            std::cout << "OR H → A=" << std::hex << (int)A << "\n";
+            trace << "OR H → A=" << std::hex << (int)A << "\n";
             break;
 
         case 0xB5:  // OR L
@@ -1804,7 +1807,7 @@ int CPU::step() {
             F = 0;
             if (A == 0) F |= FLAG_Z;
             cycles += 4;
-            std::cout << "OR L → A=" << std::hex << (int)A << "\n";
+            trace << "OR L → A=" << std::hex << (int)A << "\n";
             break;
 
         case 0xB6:  // OR (HL)
@@ -1814,7 +1817,7 @@ int CPU::step() {
             F = 0;
             if (A == 0) F |= FLAG_Z;
             cycles += 8;
-            std::cout << "OR (HL) → A=" << std::hex << (int)A << "\n";
+            trace << "OR (HL) → A=" << std::hex << (int)A << "\n";
             break;
         }
 
@@ -1822,7 +1825,7 @@ int CPU::step() {
             F = 0;
             if (A == 0) F |= FLAG_Z;
             cycles += 4;
-            std::cout << "OR A → A=" << std::hex << (int)A << "\n";
+            trace << "OR A → A=" << std::hex << (int)A << "\n";
             break;
 
         case 0xB8:  // CP B
@@ -1833,7 +1836,7 @@ int CPU::step() {
             if ((A & 0x0F) < (B & 0x0F)) F |= FLAG_H;
             if (A < B) F |= FLAG_C;
             cycles += 4;
-            std::cout << "CP B (A=" << (int)A << ",B=" << (int)B << ")\n";
+            trace << "CP B (A=" << (int)A << ",B=" << (int)B << ")\n";
             break;
         }
 
@@ -1845,7 +1848,7 @@ int CPU::step() {
             if ((A & 0x0F) < (C & 0x0F)) F |= FLAG_H;
             if (A < C) F |= FLAG_C;
             cycles += 4;
-            std::cout << "CP C (A=" << (int)A << ",C=" << (int)C << ")\n";
+            trace << "CP C (A=" << (int)A << ",C=" << (int)C << ")\n";
             break;
         }
 
@@ -1857,7 +1860,7 @@ int CPU::step() {
             if ((A & 0x0F) < (D & 0x0F)) F |= FLAG_H;
             if (A < D) F |= FLAG_C;
             cycles += 4;
-            std::cout << "CP D (A=" << (int)A << ",D=" << (int)D << ")\n";
+            trace << "CP D (A=" << (int)A << ",D=" << (int)D << ")\n";
             break;
         }
 
@@ -1869,7 +1872,7 @@ int CPU::step() {
             if ((A & 0x0F) < (E & 0x0F)) F |= FLAG_H;
             if (A < E) F |= FLAG_C;
             cycles += 4;
-            std::cout << "CP E (A=" << (int)A << ",E=" << (int)E << ")\n";
+            trace << "CP E (A=" << (int)A << ",E=" << (int)E << ")\n";
             break;
         }
 
@@ -1881,7 +1884,7 @@ int CPU::step() {
             if ((A & 0x0F) < (H & 0x0F)) F |= FLAG_H;
             if (A < H) F |= FLAG_C;
             cycles += 4;
-            std::cout << "CP H (A=" << (int)A << ",H=" << (int)H << ")\n";
+            trace << "CP H (A=" << (int)A << ",H=" << (int)H << ")\n";
             break;
         }
 
@@ -1893,7 +1896,7 @@ int CPU::step() {
             if ((A & 0x0F) < (L & 0x0F)) F |= FLAG_H;
             if (A < L) F |= FLAG_C;
             cycles += 4;
-            std::cout << "CP L (A=" << (int)A << ",L=" << (int)L << ")\n";
+            trace << "CP L (A=" << (int)A << ",L=" << (int)L << ")\n";
             break;
         }
 
@@ -1906,14 +1909,14 @@ int CPU::step() {
             if ((A & 0x0F) < (val & 0x0F)) F |= FLAG_H;
             if (A < val) F |= FLAG_C;
             cycles += 8;
-            std::cout << "CP (HL) (A=" << (int)A << ",val=" << (int)val << ")\n";
+            trace << "CP (HL) (A=" << (int)A << ",val=" << (int)val << ")\n";
             break;
         }
 
         case 0xBF:  // CP A
             F = FLAG_N | FLAG_Z;
             cycles += 4;
-            std::cout << "CP A (compare with itself)\n";
+            trace << "CP A (compare with itself)\n";
             break;
 
         // ----- 0xC0〜0xCF : RET/CALL/JP -----
@@ -1925,10 +1928,10 @@ int CPU::step() {
                     PC = (hi << 8) | lo;
                 }
                 cycles += 20;
-                std::cout << "RET NZ → PC=" << std::hex << PC << "\n";
+                trace << "RET NZ → PC=" << std::hex << PC << "\n";
             } else {
                 cycles += 8;
-                std::cout << "RET NZ skipped (Z=1)\n";
+                trace << "RET NZ skipped (Z=1)\n";
             }
             break;
 
@@ -1939,7 +1942,7 @@ int CPU::step() {
             C = lo;
             B = hi;
             cycles += 12;
-            std::cout << "POP BC → B=" << std::hex << (int)B
+            trace << "POP BC → B=" << std::hex << (int)B
                       << " C=" << (int)C << "\n";
             break;
         }
@@ -1952,10 +1955,10 @@ int CPU::step() {
             if (!(F & FLAG_Z)) {
                 PC = addr;
                 cycles += 16;
-                std::cout << "JP NZ → " << std::hex << PC << "\n";
+                trace << "JP NZ → " << std::hex << PC << "\n";
             } else {
                 cycles += 12;
-                std::cout << "JP NZ skipped (Z=1)\n";
+                trace << "JP NZ skipped (Z=1)\n";
             }
             break;
         }
@@ -1968,7 +1971,7 @@ int CPU::step() {
             uint16_t addr = (hi << 8) | lo;
 
             // Gearboy形式で出力
-            std::cout << std::hex << std::setfill('0') << std::setw(2)
+            trace << std::hex << std::setfill('0') << std::setw(2)
                       << ((oldPC >> 8) & 0xFF) << ":"
                       << std::setw(4) << oldPC << " C3 "
                       << std::setw(2) << (int)lo << " "
@@ -1993,10 +1996,10 @@ int CPU::step() {
                 SP--; memory->writeByte(SP, pcLo);
                 PC = addr;
                 cycles += 24;
-                std::cout << "CALL NZ → " << std::hex << addr << "\n";
+                trace << "CALL NZ → " << std::hex << addr << "\n";
             } else {
                 cycles += 12;
-                std::cout << "CALL NZ skipped (Z=1)\n";
+                trace << "CALL NZ skipped (Z=1)\n";
             }
             break;
         }
@@ -2008,7 +2011,7 @@ int CPU::step() {
             SP--; memory->writeByte(SP, pcHi);
             SP--; memory->writeByte(SP, pcLo);
             cycles += 16;
-            std::cout << "PUSH BC (B=" << std::hex << (int)B
+            trace << "PUSH BC (B=" << std::hex << (int)B
                       << ", C=" << (int)C << ")\n";
             break;
         }
@@ -2023,7 +2026,7 @@ int CPU::step() {
             if (result > 0xFF) F |= FLAG_C;
             A = result & 0xFF;
             cycles += 8;
-            std::cout << "ADD A," << std::hex << (int)val
+            trace << "ADD A," << std::hex << (int)val
                       << " → A=" << (int)A << "\n";
             break;
         }
@@ -2036,7 +2039,7 @@ int CPU::step() {
             SP--; memory->writeByte(SP, pcLo);
             PC = 0x00;
             cycles += 16;
-            std::cout << "RST 00h\n";
+            trace << "RST 00h\n";
             break;
         }
 
@@ -2046,7 +2049,7 @@ int CPU::step() {
             uint8_t hi = memory->readByte(SP++);
             PC = (hi << 8) | lo;
             cycles += 16;
-            std::cout << "RET → PC=" << std::hex << PC << "\n";
+            trace << "RET → PC=" << std::hex << PC << "\n";
             break;
         }
 
@@ -2056,10 +2059,10 @@ int CPU::step() {
                 uint8_t hi = memory->readByte(SP++);
                 PC = (hi << 8) | lo;
                 cycles += 20;
-                std::cout << "RET Z → PC=" << std::hex << PC << "\n";
+                trace << "RET Z → PC=" << std::hex << PC << "\n";
             } else {
                 cycles += 8;
-                std::cout << "RET Z skipped (Z=0)\n";
+                trace << "RET Z skipped (Z=0)\n";
             }
             break;
 
@@ -2071,10 +2074,10 @@ int CPU::step() {
             if (F & FLAG_Z) {
                 PC = addr;
                 cycles += 16;
-                std::cout << "JP Z → " << std::hex << PC << "\n";
+                trace << "JP Z → " << std::hex << PC << "\n";
             } else {
                 cycles += 12;
-                std::cout << "JP Z skipped (Z=0)\n";
+                trace << "JP Z skipped (Z=0)\n";
             }
             break;
         }
@@ -2093,7 +2096,7 @@ int CPU::step() {
             SP--; memory->writeByte(SP, pclo);
             PC = addr;
             cycles += 24;
-            std::cout << "CALL " << std::hex << addr << "\n";
+            trace << "CALL " << std::hex << addr << "\n";
             break;
         }
 
@@ -2109,10 +2112,10 @@ int CPU::step() {
                 SP--; memory->writeByte(SP, pcLo);
                 PC = addr;
                 cycles += 24;
-                std::cout << "CALL Z → " << std::hex << addr << "\n";
+                trace << "CALL Z → " << std::hex << addr << "\n";
             } else {
                 cycles += 12;
-                std::cout << "CALL Z skipped (Z=0)\n";
+                trace << "CALL Z skipped (Z=0)\n";
             }
             break;
         }
@@ -2128,7 +2131,7 @@ int CPU::step() {
             if (result > 0xFF) F |= FLAG_C;
             A = result & 0xFF;
             cycles += 8;
-            std::cout << "ADC A," << std::hex << (int)val
+            trace << "ADC A," << std::hex << (int)val
                       << " → A=" << (int)A << "\n";
             break;
         }
@@ -2141,7 +2144,7 @@ int CPU::step() {
             SP--; memory->writeByte(SP, pcLo);
             PC = 0x08;
             cycles += 16;
-            std::cout << "RST 08h\n";
+            trace << "RST 08h\n";
             break;
         }
 
@@ -2152,10 +2155,10 @@ int CPU::step() {
                 uint8_t hi = memory->readByte(SP++);
                 PC = (hi << 8) | lo;
                 cycles += 20;
-                std::cout << "RET NC → PC=" << std::hex << PC << "\n";
+                trace << "RET NC → PC=" << std::hex << PC << "\n";
             } else {
                 cycles += 8;
-                std::cout << "RET NC skipped (C=1)\n";
+                trace << "RET NC skipped (C=1)\n";
             }
             break;
 
@@ -2166,7 +2169,7 @@ int CPU::step() {
             E = lo;
             D = hi;
             cycles += 12;
-            std::cout << "POP DE → D=" << std::hex << (int)D
+            trace << "POP DE → D=" << std::hex << (int)D
                       << " E=" << (int)E << "\n";
             break;
         }
@@ -2179,10 +2182,10 @@ int CPU::step() {
             if (!(F & FLAG_C)) {
                 PC = addr;
                 cycles += 16;
-                std::cout << "JP NC → " << std::hex << PC << "\n";
+                trace << "JP NC → " << std::hex << PC << "\n";
             } else {
                 cycles += 12;
-                std::cout << "JP NC skipped (C=1)\n";
+                trace << "JP NC skipped (C=1)\n";
             }
             break;
         }
@@ -2199,10 +2202,10 @@ int CPU::step() {
                 SP--; memory->writeByte(SP, pcLo);
                 PC = addr;
                 cycles += 24;
-                std::cout << "CALL NC → " << std::hex << addr << "\n";
+                trace << "CALL NC → " << std::hex << addr << "\n";
             } else {
                 cycles += 12;
-                std::cout << "CALL NC skipped (C=1)\n";
+                trace << "CALL NC skipped (C=1)\n";
             }
             break;
         }
@@ -2214,7 +2217,7 @@ int CPU::step() {
             SP--; memory->writeByte(SP, hi);
             SP--; memory->writeByte(SP, lo);
             cycles += 16;
-            std::cout << "PUSH DE (D=" << std::hex << (int)D
+            trace << "PUSH DE (D=" << std::hex << (int)D
                       << ", E=" << (int)E << ")\n";
             break;
         }
@@ -2229,7 +2232,7 @@ int CPU::step() {
             if (A < val) F |= FLAG_C;
             A = result & 0xFF;
             cycles += 8;
-            std::cout << "SUB " << std::hex << (int)val
+            trace << "SUB " << std::hex << (int)val
                       << " → A=" << (int)A << "\n";
             break;
         }
@@ -2242,7 +2245,7 @@ int CPU::step() {
             SP--; memory->writeByte(SP, pcLo);
             PC = 0x10;
             cycles += 16;
-            std::cout << "RST 10h\n";
+            trace << "RST 10h\n";
             break;
         }
 
@@ -2252,10 +2255,10 @@ int CPU::step() {
                 uint8_t hi = memory->readByte(SP++);
                 PC = (hi << 8) | lo;
                 cycles += 20;
-                std::cout << "RET C → PC=" << std::hex << PC << "\n";
+                trace << "RET C → PC=" << std::hex << PC << "\n";
             } else {
                 cycles += 8;
-                std::cout << "RET C skipped (C=0)\n";
+                trace << "RET C skipped (C=0)\n";
             }
             break;
 
@@ -2266,7 +2269,7 @@ int CPU::step() {
             PC = (hi << 8) | lo;
             ime = true;
             cycles += 16;
-            std::cout << "RETI → PC=" << std::hex << PC << " (IME=1)\n";
+            trace << "RETI → PC=" << std::hex << PC << " (IME=1)\n";
             break;
         }
 
@@ -2278,10 +2281,10 @@ int CPU::step() {
             if (F & FLAG_C) {
                 PC = addr;
                 cycles += 16;
-                std::cout << "JP C → " << std::hex << PC << "\n";
+                trace << "JP C → " << std::hex << PC << "\n";
             } else {
                 cycles += 12;
-                std::cout << "JP C skipped (C=0)\n";
+                trace << "JP C skipped (C=0)\n";
             }
             break;
         }
@@ -2298,10 +2301,10 @@ int CPU::step() {
                 SP--; memory->writeByte(SP, pcLo);
                 PC = addr;
                 cycles += 24;
-                std::cout << "CALL C → " << std::hex << addr << "\n";
+                trace << "CALL C → " << std::hex << addr << "\n";
             } else {
                 cycles += 12;
-                std::cout << "CALL C skipped (C=0)\n";
+                trace << "CALL C skipped (C=0)\n";
             }
             break;
         }
@@ -2317,7 +2320,7 @@ int CPU::step() {
             if (A < (uint16_t)val + carry) F |= FLAG_C;
             A = result & 0xFF;
             cycles += 8;
-            std::cout << "SBC A," << std::hex << (int)val
+            trace << "SBC A," << std::hex << (int)val
                       << " → A=" << (int)A << "\n";
             break;
         }
@@ -2330,7 +2333,7 @@ int CPU::step() {
             SP--; memory->writeByte(SP, pcLo);
             PC = 0x18;
             cycles += 16;
-            std::cout << "RST 18h\n";
+            trace << "RST 18h\n";
             break;
         }
 
@@ -2341,7 +2344,7 @@ int CPU::step() {
             uint16_t addr = 0xFF00 + offset;
             memory->writeByte(addr, A);
             cycles += 12;
-            std::cout << "LDH (" << std::hex << addr << "),A=" << (int)A << "\n";
+            trace << "LDH (" << std::hex << addr << "),A=" << (int)A << "\n";
             break;
         }
 
@@ -2352,7 +2355,7 @@ int CPU::step() {
             L = lo;
             H = hi;
             cycles += 12;
-            std::cout << "POP HL → H=" << std::hex << (int)H
+            trace << "POP HL → H=" << std::hex << (int)H
                       << " L=" << (int)L << "\n";
             break;
         }
@@ -2362,7 +2365,7 @@ int CPU::step() {
             uint16_t addr = 0xFF00 + C;
             memory->writeByte(addr, A);
             cycles += 8;
-            std::cout << "LD (C),A → [" << std::hex << addr << "]=" << (int)A << "\n";
+            trace << "LD (C),A → [" << std::hex << addr << "]=" << (int)A << "\n";
             break;
         }
 
@@ -2373,7 +2376,7 @@ int CPU::step() {
             SP--; memory->writeByte(SP, hi);
             SP--; memory->writeByte(SP, lo);
             cycles += 16;
-            std::cout << "PUSH HL (H=" << std::hex << (int)H
+            trace << "PUSH HL (H=" << std::hex << (int)H
                       << ", L=" << (int)L << ")\n";
             break;
         }
@@ -2385,7 +2388,7 @@ int CPU::step() {
             F = FLAG_H;
             if (A == 0) F |= FLAG_Z;
             cycles += 8;
-            std::cout << "AND " << std::hex << (int)val
+            trace << "AND " << std::hex << (int)val
                       << " → A=" << (int)A << "\n";
             break;
         }
@@ -2398,7 +2401,7 @@ int CPU::step() {
             SP--; memory->writeByte(SP, pcLo);
             PC = 0x20;
             cycles += 16;
-            std::cout << "RST 20h\n";
+            trace << "RST 20h\n";
             break;
         }
 
@@ -2417,7 +2420,7 @@ int CPU::step() {
 
             SP = result;
             cycles += 16;
-            std::cout << "ADD SP," << std::dec << (int)offset
+            trace << "ADD SP," << std::dec << (int)offset
                       << " → SP=" << std::hex << SP << "\n";
             break;
         }
@@ -2425,7 +2428,7 @@ int CPU::step() {
         case 0xE9:  // JP (HL)
             PC = (H << 8) | L;
             cycles += 4;
-            std::cout << "JP (HL) → PC=" << std::hex << PC << "\n";
+            trace << "JP (HL) → PC=" << std::hex << PC << "\n";
             break;
 
         case 0xEE:  // XOR d8
@@ -2435,7 +2438,7 @@ int CPU::step() {
             F = 0;
             if (A == 0) F |= FLAG_Z;
             cycles += 8;
-            std::cout << "XOR " << std::hex << (int)val
+            trace << "XOR " << std::hex << (int)val
                       << " → A=" << (int)A << "\n";
             break;
         }
@@ -2448,7 +2451,7 @@ int CPU::step() {
             SP--; memory->writeByte(SP, pcLo);
             PC = 0x28;
             cycles += 16;
-            std::cout << "RST 28h\n";
+            trace << "RST 28h\n";
             break;
         }
 
@@ -2459,7 +2462,7 @@ int CPU::step() {
             uint16_t addr = (hi<<8)|lo;
             memory->writeByte(addr, A);
             cycles += 16;
-            std::cout << "LD (" << std::hex << addr << "),A=" << (int)A << "\n";
+            trace << "LD (" << std::hex << addr << "),A=" << (int)A << "\n";
             break;
         }
 
@@ -2469,7 +2472,7 @@ int CPU::step() {
             uint16_t addr = 0xFF00 + offset;
             A = memory->readByte(addr);
             cycles += 12;
-            std::cout << "LDH A,(" << std::hex << addr << ") → A=" << (int)A << "\n";
+            trace << "LDH A,(" << std::hex << addr << ") → A=" << (int)A << "\n";
             break;
         }
 
@@ -2479,7 +2482,7 @@ int CPU::step() {
             A = memory->readByte(SP++);
             F &= 0xF0;
             cycles += 12;
-            std::cout << "POP AF → A=" << (int)A << " F=" << (int)F << "\n";
+            trace << "POP AF → A=" << (int)A << " F=" << (int)F << "\n";
             break;
         }
 
@@ -2488,7 +2491,7 @@ int CPU::step() {
             uint16_t addr = 0xFF00 + C;
             A = memory->readByte(addr);
             cycles += 8;
-            std::cout << "LD A,(C) → A=" << std::hex << (int)A << "\n";
+            trace << "LD A,(C) → A=" << std::hex << (int)A << "\n";
             break;
         }
 
@@ -2496,7 +2499,7 @@ int CPU::step() {
             ime = false;
             ime_enable_delay = 0;  // 保留中のEIもキャンセル
             cycles += 4;
-            std::cout << "DI (Disable Interrupts)\n";
+            trace << "DI (Disable Interrupts)\n";
             break;
 
         case 0xF5:  // PUSH AF
@@ -2506,7 +2509,7 @@ int CPU::step() {
             SP--;
             memory->writeByte(SP, F & 0xF0);           // 下位4bitを必ず0にマスク
             cycles += 16;
-            std::cout << "PUSH AF → A=" << (int)A
+            trace << "PUSH AF → A=" << (int)A
                         << " F=" << (int)(F & 0xF0) << "\n";
             break;
         }
@@ -2519,7 +2522,7 @@ int CPU::step() {
             F = 0;
             if (A == 0) F |= FLAG_Z;
             cycles += 8;
-            std::cout << "OR " << std::hex << (int)val
+            trace << "OR " << std::hex << (int)val
                       << " → A=" << (int)A << "\n";
             break;
         }
@@ -2532,7 +2535,7 @@ int CPU::step() {
             SP--; memory->writeByte(SP, pcLo);
             PC = 0x30;
             cycles += 16;
-            std::cout << "RST 30h\n";
+            trace << "RST 30h\n";
             break;
         }
 
@@ -2552,7 +2555,7 @@ int CPU::step() {
             H = (result >> 8) & 0xFF;
             L = result & 0xFF;
             cycles += 12;
-            std::cout << "LD HL,SP+" << std::dec << (int)offset
+            trace << "LD HL,SP+" << std::dec << (int)offset
                       << " → HL=" << std::hex << result << "\n";
             break;
         }
@@ -2560,7 +2563,7 @@ int CPU::step() {
         case 0xF9:  // LD SP,HL
             SP = (H << 8) | L;
             cycles += 8;
-            std::cout << "LD SP,HL → SP=" << std::hex << SP << "\n";
+            trace << "LD SP,HL → SP=" << std::hex << SP << "\n";
             break;
 
         case 0xFA:  // LD A,(a16)
@@ -2570,14 +2573,14 @@ int CPU::step() {
             uint16_t addr = (hi << 8) | lo;
             A = memory->readByte(addr);
             cycles += 16;
-            std::cout << "LD A,(" << std::hex << addr << ") → A=" << (int)A << "\n";
+            trace << "LD A,(" << std::hex << addr << ") → A=" << (int)A << "\n";
             break;
         }
 
         case 0xFB:  // EI
             ime_enable_delay = 2;  // 次の命令完了後にIMEを有効化
             cycles += 4;
-            std::cout << "EI (Enable Interrupts - delayed)\n";
+            trace << "EI (Enable Interrupts - delayed)\n";
             break;
 
         case 0xFF:  // RST 38h
@@ -2588,7 +2591,7 @@ int CPU::step() {
             SP--; memory->writeByte(SP, pcLo);
             PC = 0x38;
             cycles += 16;
-            std::cout << "RST 38h\n";
+            trace << "RST 38h\n";
             break;
         }
 
@@ -2601,13 +2604,13 @@ int CPU::step() {
             if ((A & 0x0F) < (val & 0x0F)) F |= FLAG_H;
             if (A < val) F |= FLAG_C;
             cycles += 8;
-            std::cout << "CP " << (int)val << " (A=" << (int)A << ")\n";
+            trace << "CP " << (int)val << " (A=" << (int)A << ")\n";
             break;
         }
 
 
         default:
-            std::cout << "Unknown opcode: 0x"
+            trace << "Unknown opcode: 0x"
                       << std::hex << (int)opcode
                       << " at PC=" << PC-1 << "\n";
             break;
@@ -2618,13 +2621,13 @@ int CPU::step() {
         ime_enable_delay--;
         if (ime_enable_delay == 0) {
             ime = true;
-            std::cout << "EI delay complete - IME enabled\n";
+            trace << "EI delay complete - IME enabled\n";
         }
     }
 
     // デバッグ：異常なサイクル値を検出
     if (cycles == 0 || cycles > 100) {
-        std::cout << "[CPU] Abnormal cycles: " << cycles << " at PC=" << std::hex << (PC-1) << std::endl;
+        trace << "[CPU] Abnormal cycles: " << cycles << " at PC=" << std::hex << (PC-1) << std::endl;
     }
 
     return cycles;
@@ -2649,34 +2652,40 @@ void CPU::handleInterrupts() {
 
     // 割り込みを受け付けたら IME をクリア
     ime = false;
-    std::cout << "================interruput start=================" << std::endl;
+    trace << "================interruput start=================" << std::endl;
 
     // 優先順位: V-Blank → LCD → Timer → Serial → Joypad
     uint16_t vector = 0;
     if (req & 0x01) {            // V-Blank
         vector = 0x40;
         memory->if_reg &= ~0x01;
-        std::cout << "[INT] VBlank\n";
+        trace << "[INT] VBlank\n";
     } else if (req & 0x02) {     // LCD STAT
         vector = 0x48;
         memory->if_reg &= ~0x02;
-        std::cout << "[INT] LCD STAT\n";
+        trace << "[INT] LCD STAT\n";
     } else if (req & 0x04) {     // Timer
         vector = 0x50;
         memory->if_reg &= ~0x04;
-        std::cout << "[INT] Timer\n";
+        trace << "[INT] Timer\n";
     } else if (req & 0x08) {     // Serial
         vector = 0x58;
         memory->if_reg &= ~0x08;
-        std::cout << "[INT] Serial\n";
+        trace << "[INT] Serial\n";
     } else if (req & 0x10) {     // Joypad
         vector = 0x60;
         memory->if_reg &= ~0x10;
-        std::cout << "[INT] Joypad\n";
+        trace << "[INT] Joypad\n";
     } else {
         return;  // どれも無ければ戻る
     }
 
+    if (timeline && memory->scheduler) {
+        static const char* const NAMES[] = {"int VBlank", "int STAT", "int Timer", "int Serial", "int Joypad"};
+        timeline->guestInstant(TimelineRecorder::Track::CPU, NAMES[(vector - 0x40) / 8],
+                               memory->scheduler->now(), "pc", PC);
+    }
+
     // 現在のPCをスタックへ退避
     uint8_t pcLow  = PC & 0xFF;
     uint8_t pcHigh = (PC >> 8) & 0xFF;
@@ -2812,7 +2821,7 @@ void CPU::executeCB()
                 storeVal(val);
             }
             else {
-                std::cout << "CB opcode not implemented: 0x"
+                trace << "CB opcode not implemented: 0x"
                           << std::hex << (int)cbcode << "\n";
             }
             break;
@@ -2836,3 +2845,27 @@ uint8_t& CPU::getRegisterRef(uint8_t code) {
     }
 }
 
+
+void CPU::saveState(StateWriter& out) const {
+    out.writeTag("CPU ");
+    const uint8_t regs[8] = {A, F, B, C, D, E, H, L};
+    out.writeBytes(regs, sizeof(regs));
+    out.write16(PC);
+    out.write16(SP);
+    out.writeBool(ime);
+    out.writeBool(halted);
+    out.write8(ime_enable_delay);
+}
+
+void CPU::loadState(StateReader& in) {
+    if (!in.expectTag("CPU ")) return;
+    uint8_t regs[8];
+    in.readBytes(regs, sizeof(regs));
+    A = regs[0]; F = regs[1]; B = regs[2]; C = regs[3];
+    D = regs[4]; E = regs[5]; H = regs[6]; L = regs[7];
+    PC = in.read16();
+    SP = in.read16();
+    ime = in.readBool();
+    halted = in.readBool();
+    ime_enable_delay = in.read8();
+}
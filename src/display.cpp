@@ -1,5 +1,9 @@
 #include "display.hpp"
 #include "input.hpp"
+#include "profiler.hpp"
+#include "timeline.hpp"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 Display::Display() = default;
@@ -13,6 +17,7 @@ bool Display::init() {
         std::cerr << "SDL init error: " << SDL_GetError() << std::endl;
         return false;
     }
+    sdlInitialized = true;
 
     window = SDL_CreateWindow(
         "Game Boy Emulator",
@@ -47,32 +52,72 @@ bool Display::init() {
         return false;
     }
 
+    textureValid = false;
     std::cout << "SDL2 display initialized successfully" << std::endl;
     return true;
 }
 
-void Display::updateFrame(const uint32_t* framebuffer) {
-    if (!texture || !renderer) return;
-
-    void* pixels;
-    int pitch;
-
-    if (SDL_LockTexture(texture, nullptr, &pixels, &pitch) == 0) {
-        uint32_t* dest = static_cast<uint32_t*>(pixels);
-
-        for (int y = 0; y < GB_HEIGHT; ++y) {
-            for (int x = 0; x < GB_WIDTH; ++x) {
-                dest[y * GB_WIDTH + x] = framebuffer[y * GB_WIDTH + x];
+void Display::uploadRows(const uint8_t* pixels, int pitch, int firstRow, int rowCount) {
+    constexpr size_t ROW_BYTES = GB_WIDTH * 4;
+    SDL_Rect rect{0, firstRow, GB_WIDTH, rowCount};
+    const uint8_t* src = pixels + firstRow * pitch;
+    void* locked;
+    int lockedPitch;
+
+    if (SDL_LockTexture(texture, &rect, &locked, &lockedPitch) == 0) {
+        // 変換済みなので行のコピーだけ（pitchが同じなら区間まとめて1回）
+        uint8_t* dest = static_cast<uint8_t*>(locked);
+        if (lockedPitch == pitch) {
+            std::memcpy(dest, src, static_cast<size_t>(rowCount - 1) * pitch + ROW_BYTES);
+        } else {
+            for (int y = 0; y < rowCount; ++y) {
+                std::memcpy(dest + y * lockedPitch, src + y * pitch, ROW_BYTES);
             }
         }
-
         SDL_UnlockTexture(texture);
+    } else if (SDL_UpdateTexture(texture, &rect, src, pitch) != 0) {
+        std::cerr << "Texture update error: " << SDL_GetError() << std::endl;
     }
+}
 
+void Display::updateFrame(const void* pixels, int pitch, const uint64_t* lineHashes) {
+    GB_PROFILE_SCOPE(profiler, ProfileSection::Display);
+    if (!texture || !renderer) return;
+    const uint64_t uploadStart = timeline ? timeline->hostNow() : 0;
+    const uint8_t* rows = static_cast<const uint8_t*>(pixels);
+
+    if (!lineHashes || !textureValid) {
+        uploadRows(rows, pitch, 0, GB_HEIGHT);
+        if (lineHashes) {
+            std::copy(lineHashes, lineHashes + GB_HEIGHT, uploadedHashes);
+            textureValid = true;
+        }
+    } else {
+        // 変化した行を連続区間ごとにまとめて転送
+        int y = 0;
+        while (y < GB_HEIGHT) {
+            if (lineHashes[y] == uploadedHashes[y]) {
+                ++y;
+                continue;
+            }
+            int first = y;
+            while (y < GB_HEIGHT && lineHashes[y] != uploadedHashes[y]) {
+                uploadedHashes[y] = lineHashes[y];
+                ++y;
+            }
+            uploadRows(rows, pitch, first, y - first);
+        }
+    }
+
+    const uint64_t presentStart = timeline ? timeline->hostNow() : 0;
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
     SDL_RenderClear(renderer);
     SDL_RenderCopy(renderer, texture, nullptr, nullptr);
     SDL_RenderPresent(renderer);
+    if (timeline) {
+        timeline->hostSpan("texture upload", uploadStart, presentStart);
+        timeline->hostSpan("present", presentStart, timeline->hostNow());
+    }
 }
 
 bool Display::handleEvents(Input* input) {
@@ -89,6 +134,12 @@ bool Display::handleEvents(Input* input) {
             if (event.key.keysym.sym == SDLK_ESCAPE && pressed) {
                 return false;
             }
+            if (event.key.keysym.sym == SDLK_BACKSPACE) {
+                rewindHeld = pressed;
+            }
+            if (event.key.keysym.sym == SDLK_TAB) {
+                turboHeld = pressed;
+            }
 
             // Game Boyキーマッピング (input が null でない場合のみ)
             if (input) {
@@ -136,6 +187,7 @@ void Display::close() {
         SDL_DestroyTexture(texture);
         texture = nullptr;
     }
+    textureValid = false;
     if (renderer) {
         SDL_DestroyRenderer(renderer);
         renderer = nullptr;
@@ -144,5 +196,8 @@ void Display::close() {
         SDL_DestroyWindow(window);
         window = nullptr;
     }
-    SDL_Quit();
+    if (sdlInitialized) {
+        SDL_Quit();
+        sdlInitialized = false;
+    }
 }
\ No newline at end of file
@@ -1,194 +1,419 @@
 #include "emulator.hpp"
+#include "savestate.hpp"
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
 
 Emulator::Emulator()
     : ppu(memory),
       cpu(&memory, &ppu),
-      timer(&memory) {
+      timer(&memory),
+      serial(&memory),
+      scheduler(ppu, timer, serial, memory) {
     // MemoryにInputの参照を設定
     memory.setInputReference(&input);
+    memory.setScheduler(&scheduler);
+#ifdef GAMEBOY_PROFILE
+    memory.setProfiler(&profiler);
+    scheduler.setProfiler(&profiler);
+#endif
+    memory.setTimerReference(&timer);
+    memory.setSerialReference(&serial);
+    serial.setSink([this](uint8_t byte) { onSerialByte(byte); });
 }
 
-void Emulator::loadROM(const std::string& path) {
-    memory.loadROM(path);
+bool Emulator::loadROM(const std::string& path) {
+    if (!memory.loadROM(path)) {
+        return false;
+    }
+    reset();
+    return true;
+}
+
+bool Emulator::loadROMData(const uint8_t* data, size_t size) {
+    if (!memory.loadROMData(data, size)) {
+        return false;
+    }
+    reset();
+    return true;
+}
+
+void Emulator::reset() {
     cpu.reset(); // ROMロード後にCPUを初期化
     timer.reset(); // タイマーも初期化
+    serial.reset();
+    scheduler.reset();
+    serialOutput.clear();
+    nextFrameCycle = FRAME_CYCLES;
+    ppu.setClock(0);
+    haltStart = Scheduler::NEVER;
 }
 
-void Emulator::run() {
-    std::cout << "Emulator running...\n";
-
-    // 0x0100番地（プログラム開始地点）の内容を確認
-    std::cout << "\n=== Memory dump from 0x0100 (start) ===\n";
-    for (uint16_t addr = 0x0100; addr <= 0x010F; addr++) {
-        uint8_t val = memory.readByte(addr);
-        std::cout << std::hex << std::setfill('0') << std::setw(4) << addr
-                  << ": " << std::setw(2) << (int)val << std::dec << std::endl;
+void Emulator::onSerialByte(uint8_t byte) {
+    // 転送完了時（同期の内側）に1バイトずつ呼ばれる
+    serialOutput += static_cast<char>(byte);
+    if (serialMatch < 0) {
+        serialMatch = serialMatcher.feed(byte);
     }
-    std::cout << "=====================================\n";
-
-    // 0xC7D0周辺のメモリ内容を確認
-    std::cout << "\n=== Memory dump around 0xC7D0 ===\n";
-    for (uint16_t addr = 0xC7D0; addr <= 0xC7DF; addr++) {
-        uint8_t val = memory.readByte(addr);
-        std::cout << std::hex << std::setfill('0') << std::setw(4) << addr
-                  << ": " << std::setw(2) << (int)val << std::dec << std::endl;
+    if (serialSink) {
+        serialSink(byte);
     }
-    std::cout << "================================\n\n";
+}
 
-    int totalCycles = 0;
-    long long stepCount = 0;
-    const int MAX_CYCLES = 2000000000;
-    std::string output;                     // ★ここに文字を貯める
+void Emulator::saveState(std::vector<uint8_t>& out) {
+    scheduler.sync();
+    out.clear();
+    StateWriter writer(out);
+    writer.write32(STATE_MAGIC);
+    writer.write16(STATE_VERSION);
+    writer.write64(memory.getROMHash());
+    cpu.saveState(writer);
+    memory.saveState(writer);
+    ppu.saveState(writer);
+    timer.saveState(writer);
+    serial.saveState(writer);
+    input.saveState(writer);
+    scheduler.saveState(writer);
+    writer.writeTag("END ");
+}
 
-    int serialCount = 0;
-    int serialLimit = 100;                    // ★上限回数で停止
-    uint8_t lastSC = 0;
-    int serialDelay = 0;                      // シリアル転送遅延カウンタ
+uint64_t Emulator::getStateHash() {
+    // 画面（フレームバッファ・ラインハッシュ・描画の間引き状態）は描画モードで変わるので含めない。
+    // 描画を省いて再生しても、記録時と同じ進行なら同じ値になる
+    scheduler.sync();
+    hashScratch.clear();
+    StateWriter writer(hashScratch);
+    writer.write64(memory.getROMHash());
+    cpu.saveState(writer);
+    memory.saveState(writer);
+    ppu.saveTimingState(writer);
+    timer.saveState(writer);
+    serial.saveState(writer);
+    input.saveState(writer);
+    scheduler.saveState(writer);
+    uint64_t hash = 0xcbf29ce484222325ULL;  // FNV-1a
+    for (uint8_t b : hashScratch) {
+        hash = (hash ^ b) * 0x100000001b3ULL;
+    }
+    return hash;
+}
 
-    while (totalCycles < MAX_CYCLES) {
-        int cycles = cpu.step();
-        ++stepCount;
+bool Emulator::applyState(const uint8_t* data, size_t size) {
+    StateReader reader(data, size);
+    if (reader.read32() != STATE_MAGIC || reader.read16() != STATE_VERSION) {
+        std::cerr << "[STATE] Unsupported save state format" << std::endl;
+        return false;
+    }
+    if (reader.read64() != memory.getROMHash()) {
+        std::cerr << "[STATE] Save state belongs to a different ROM" << std::endl;
+        return false;
+    }
+    cpu.loadState(reader);
+    memory.loadState(reader);
+    ppu.loadState(reader);
+    timer.loadState(reader);
+    serial.loadState(reader);
+    input.loadState(reader);
+    scheduler.loadState(reader);
+    reader.expectTag("END ");
+    if (!reader.ok() || !reader.atEnd()) {
+        std::cerr << "[STATE] Corrupt save state" << std::endl;
+        return false;
+    }
+    // 各コンポーネントの期限をここで計算し直す（後続のschedule()が「次の命令の前に同期」を
+    // 上書きすると、次のフレーム境界までPPU/Timerの割り込みが届かなくなる）
+    scheduler.sync();
+    ppu.setClock(scheduler.now());
+    haltStart = Scheduler::NEVER;
+    return true;
+}
 
-        // 1Tサイクルずつ実行してレジスタ更新を即座に反映
-        for (int i = 0; i < cycles; i++) {
-            ppu.step(1);
-            timer.step(1);
-            memory.stepDMA();  // OAM DMA処理
-            totalCycles++;
-        }
+bool Emulator::loadState(const uint8_t* data, size_t size) {
+    // 途中で壊れていると各コンポーネントが中途半端になるので、現状態を控えて戻せるようにする
+    std::vector<uint8_t> backup;
+    saveState(backup);
+    if (applyState(data, size)) {
+        nextFrameCycle = scheduler.now() + FRAME_CYCLES;  // フレームの区切りは復元した時点から
+        return true;
+    }
+    applyState(backup.data(), backup.size());
+    return false;
+}
 
-        uint8_t sc = memory.readByte(0xFF02);
+bool Emulator::cloneState(const Emulator& source, const std::vector<uint8_t>& state) {
+    // sourceは同じROMで正常に動いているので、ロールバック用の控えは取らない
+    if (!applyState(state.data(), state.size())) {
+        return false;
+    }
+    nextFrameCycle = source.nextFrameCycle;
+    return true;
+}
 
-        // シリアル転送の遅延処理
-        if (serialDelay > 0) {
-            serialDelay--;
-            if (serialDelay == 0) {
-                // 転送完了 → SC.bit7を0に戻す
-                memory.writeByte(0xFF02, 0x00);
-                std::cout << " [Transfer complete]\n";
-            }
-        }
+void Emulator::saveSnapshot(std::vector<uint8_t>& out) {
+    saveState(out);
+    StateWriter writer(out);
+    writer.write64(nextFrameCycle);  // セーブステート本体の後ろに付ける
+}
 
-        // SCを再読み取り（遅延処理後の正しい値を取得）
-        sc = memory.readByte(0xFF02);
+bool Emulator::restoreSnapshot(const std::vector<uint8_t>& snapshot) {
+    if (snapshot.size() < 8) {
+        return false;
+    }
+    const size_t stateSize = snapshot.size() - 8;
+    if (!applyState(snapshot.data(), stateSize)) {
+        return false;
+    }
+    StateReader reader(snapshot.data() + stateSize, 8);
+    nextFrameCycle = reader.read64();
+    return true;
+}
 
-        // デバッグ: SCが変わったら表示
-        if (sc != lastSC && (sc == 0x80 || sc == 0x81)) {
-            std::cout << "[DEBUG] SC changed: "
-                      << std::hex << (int)lastSC << " -> "
-                      << (int)sc << std::dec << "\n";
-        }
-        lastSC = sc;
+bool Emulator::saveStateFile(const std::string& path) {
+    std::vector<uint8_t> state;
+    saveState(state);
+    std::ofstream file(path, std::ios::binary);
+    if (!file.write(reinterpret_cast<const char*>(state.data()), state.size())) {
+        std::cerr << "[STATE] Failed to write save state: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
 
-        // シリアル出力チェック（新規転送開始の検出）
-        if (sc == 0x81 && serialDelay == 0) {  // 新しい転送開始
-            char c = static_cast<char>(memory.readByte(0xFF01));
-            std::cout << c << std::flush;  // デバッグ表示を簡素化
+bool Emulator::loadStateFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "[STATE] Failed to open save state: " << path << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> state((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return loadState(state.data(), state.size());
+}
 
-            // ★受け取った文字を蓄積
-            output += c;
-            std::cout<<"output = " << output << std::endl;
+void Emulator::runUntil(uint64_t targetCycle) {
+    GB_PROFILE_THREAD(&profiler);
+    while (scheduler.now() < targetCycle) {
+        // 期限まではCPUだけを回し、PPU/Timer/DMA/Serialはスケジューラが必要な時に追いつかせる
+        scheduler.schedule(Scheduler::Event::Frame, targetCycle);
+        do {
+            stepInstruction();
+        } while (!scheduler.eventDue());
+        scheduler.sync();
+    }
+}
 
-            // 成功パターン: "Passed"が確認されたら終了
-            if (output.find("Passed") != std::string::npos) {
-                std::cout << "\n[INFO] 'Passed' が検出されました！テスト完了。\n";
-                break;
-            }
+void Emulator::runFrame() {
+    if (nextFrameCycle <= scheduler.now()) {
+        nextFrameCycle = scheduler.now() + FRAME_CYCLES;  // run()等で境界を越えていた
+    }
+    const uint64_t hostStart = timeline ? timeline->hostNow() : 0;
+    runUntil(nextFrameCycle);
+    nextFrameCycle += FRAME_CYCLES;
+    if (timeline) {
+        timeline->hostSpan("runFrame", hostStart, timeline->hostNow(),
+                           "frame", static_cast<int64_t>(ppu.getCompletedFrames()));
+    }
+    pollProfileDump();
+}
 
-            // 失敗パターン: 完全なエラーメッセージが確認されたら終了
-            if (output.find("Failed") != std::string::npos) {
-                std::cout << "\n[INFO] テスト失敗またはエラーが検出されました。\n";
-                break;
-            }
+void Emulator::runCycles(uint64_t cycles) {
+    runUntil(scheduler.now() + cycles);
+}
 
-            // 転送遅延を設定（CPUが確認できるように数サイクル待つ）
-            serialDelay = 100;  // 100サイクル後に転送完了
+int Emulator::stepInstruction() {
+    ++instructionCount;
+    if (scheduler.eventDue()) {
+        scheduler.sync();  // 期限到来: PPU/Timer/DMAを現在時刻まで進める
+    }
 
-            // ★フォールバック: 上限回数で終了
-            serialCount++;
-            if (serialCount >= serialLimit) {
-                std::cout << "\n[INFO] シリアル転送が "
-                          << serialLimit << " 回発生したので終了します。\n";
-                break;
-            }
+    // HALT中で割り込み要求もなければ、次のイベントまで4サイクル単位で一気に進める
+    if (cpu.isHalted() && (memory.if_reg & memory.ie) == 0) {
+        uint64_t wait = scheduler.getNextDeadline() - scheduler.now();
+        uint64_t skipped = (std::min<uint64_t>(wait, FRAME_CYCLES) + 3) & ~3ULL;
+        if (timeline && haltStart == Scheduler::NEVER) {
+            haltStart = scheduler.now();
         }
+        scheduler.advance(skipped);
+        return static_cast<int>(skipped);
     }
 
-    // ★ここでこれまで受け取った文字列をまとめて表示
-    std::cout << "\n[INFO] 受信したシリアル文字列: \"" << output << "\"\n";
-
-    // フレームバッファのダンプ（簡易PPM）
-    ppu.saveFramePPM("frame.ppm");
-    std::cout << "[INFO] フレーム出力を frame.ppm に保存しました\n";
+    if (haltStart != Scheduler::NEVER) {
+        // 読み飛ばしていたHALTが明けた（タイムライン記録中のみ）
+        timeline->guestSpan(TimelineRecorder::Track::CPU, "HALT", haltStart, scheduler.now() - haltStart);
+        haltStart = Scheduler::NEVER;
+    }
+    int cycles;
+    {
+        GB_PROFILE_SCOPE(&profiler, ProfileSection::CPU);
+        cycles = cpu.step();
+    }
+    scheduler.advance(cycles);
+    return cycles;
+}
 
-    std::cout << "[INFO] 最終サイクル数: " << totalCycles << "\n";
-    std::cout << "[INFO] 70000サイクル換算ステップ数: "
-              << (totalCycles / 70000) << "\n";
-    std::cout << "[INFO] 命令実行ステップ数: " << stepCount << "\n";
+bool Emulator::isStuck(uint16_t pcBefore) const {
+    // HALT中で有効な割り込みが一つもない → 二度と起きない
+    if (cpu.isHalted()) {
+        return (memory.ie & 0x1F) == 0;
+    }
+    // 自分自身へのジャンプ（jr -2 等）で、割り込みで抜け出す見込みもない
+    return cpu.getPC() == pcBefore && (!cpu.getIME() || (memory.ie & 0x1F) == 0);
 }
 
-void Emulator::runWithDisplay() {
-    std::cout << "Initializing display...\n";
+RunResult Emulator::run(const RunOptions& options) {
+    GB_PROFILE_THREAD(&profiler);
+    RunResult result;
+    const auto wallStart = std::chrono::steady_clock::now();
+
+    serialMatcher = SerialMatcher(options.exitOnSerial);
+    serialMatch = -1;
+    const size_t serialStart = serialOutput.size();
+
+    const uint64_t startCycle = scheduler.now();
+    const uint64_t startInstructions = instructionCount;
+    const uint64_t cycleLimit = options.maxCycles ? startCycle + options.maxCycles : Scheduler::NEVER;
+    uint64_t runFrameCycle = startCycle + FRAME_CYCLES;   // このrun()でのフレーム区切り
+    uint64_t frameHostStart = timeline ? timeline->hostNow() : 0;
+    scheduler.schedule(Scheduler::Event::Frame, std::min(runFrameCycle, cycleLimit));
+
+    // 同じ同期点で複数の条件が成り立ったら、先に見つけた（より具体的な）理由を残す
+    auto exitWith = [&result](std::string reason) {
+        if (result.exitReason.empty()) {
+            result.exitReason = std::move(reason);
+        }
+    };
+
+    while (result.exitReason.empty()) {
+        // 次のイベント期限まではCPUを回すだけ。終了判定は同期点でまとめて行う
+        do {
+            const uint16_t pcBefore = cpu.getPC();
+            stepInstruction();
+            if (options.exitOnLoop && isStuck(pcBefore)) {
+                exitWith("infinite_loop");
+                break;
+            }
+        } while (!scheduler.eventDue());
+        scheduler.sync();  // シリアル転送の完了もここで処理される
 
-    if (!display.init()) {
-        std::cerr << "Failed to initialize display. Falling back to console mode.\n";
-        run();
-        return;
+        if (serialMatch >= 0) {
+            exitWith("serial:" + options.exitOnSerial[serialMatch]);
+        }
+        if (scheduler.now() >= runFrameCycle) {
+            ++result.frames;
+            runFrameCycle += FRAME_CYCLES;
+            if (timeline) {
+                const uint64_t hostNow = timeline->hostNow();
+                timeline->hostSpan("runFrame", frameHostStart, hostNow,
+                                   "frame", static_cast<int64_t>(ppu.getCompletedFrames()));
+                frameHostStart = hostNow;
+            }
+            pollProfileDump();
+            const uint64_t frameHash = ppu.getFrameHash();
+            if (std::find(options.exitOnFrameHash.begin(), options.exitOnFrameHash.end(), frameHash)
+                    != options.exitOnFrameHash.end()) {
+                exitWith("frame_hash");
+            }
+            if (options.maxFrames && result.frames >= options.maxFrames) {
+                exitWith("max_frames");
+            }
+        }
+        if (scheduler.now() >= cycleLimit) {
+            exitWith("max_cycles");
+        }
+        scheduler.schedule(Scheduler::Event::Frame, std::min(runFrameCycle, cycleLimit));
     }
 
-    std::cout << "Emulator running with SDL2 display...\n";
+    result.cycles = scheduler.now() - startCycle;
+    result.instructions = instructionCount - startInstructions;
+    result.frameHash = ppu.getFrameHash();
+    result.serialOutput = serialOutput.substr(serialStart);
+    result.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
 
-    int totalCycles = 0;
-    long long stepCount = 0;
-    const int MAX_CYCLES = 2000000000;
-    std::string output;
-
-    int frameCount = 0;
-    const int FRAME_INTERVAL = 70224; // 1フレーム分のサイクル数
+    if (!options.saveFramePath.empty()) {
+        ppu.saveFramePPM(options.saveFramePath);
+    }
+    return result;
+}
 
-    while (totalCycles < MAX_CYCLES) {
-        int cycles = cpu.step();
-        ++stepCount;
+void Emulator::setTimeline(TimelineRecorder* recorder) {
+    timeline = recorder;
+    cpu.setTimeline(recorder);
+    memory.setTimeline(recorder);
+    ppu.setTimeline(recorder);
+    haltStart = Scheduler::NEVER;
+}
 
-        // 1Tサイクルずつ実行してレジスタ更新を即座に反映
-        for (int i = 0; i < cycles; i++) {
-            ppu.step(1);
-            timer.step(1);
-            memory.stepDMA();  // OAM DMA処理
-            totalCycles++;
-        }
+ProfileStats Emulator::getProfileStats() const {
+#ifdef GAMEBOY_PROFILE
+    return profiler.getStats();
+#else
+    return ProfileStats();
+#endif
+}
 
-        // フレーム更新チェック
-        if (totalCycles - frameCount * FRAME_INTERVAL >= FRAME_INTERVAL) {
-            display.updateFrame(ppu.getFrameBuffer());
-            frameCount++;
+void Emulator::resetProfile() {
+#ifdef GAMEBOY_PROFILE
+    profiler.reset();
+#endif
+}
 
-            // SDL2イベント処理 (Inputも一緒に渡す)
-            if (!display.handleEvents(&input)) {
-                std::cout << "\n[INFO] ユーザーによる終了\n";
-                break;
-            }
-        }
+Profiler* Emulator::getProfiler() {
+#ifdef GAMEBOY_PROFILE
+    return &profiler;
+#else
+    return nullptr;
+#endif
+}
 
-        // シリアル出力処理（既存のコードを簡略化）
-        uint8_t sc = memory.readByte(0xFF02);
-        if (sc == 0x81) {
-            uint8_t data = memory.readByte(0xFF01);
-            output += static_cast<char>(data);
-            memory.writeByte(0xFF02, 0x80);
-        }
+void Emulator::pollProfileDump() {
+#ifdef GAMEBOY_PROFILE
+    if (profiler.consumeDumpRequest()) {
+        profiler.getStats().writeJSON(std::cerr);
+        std::cerr << std::endl;
+    }
+#endif
+}
 
-        // 終了条件チェック
-        if (output.find("Passed") != std::string::npos ||
-            output.find("Failed") != std::string::npos) {
-            std::cout << "\n[INFO] テスト完了: " << output << "\n";
-            //break;
+std::string escapeJSON(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        switch (c) {
+            case '"':  escaped += "\\\""; break;
+            case '\\': escaped += "\\\\"; break;
+            case '\n': escaped += "\\n"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned char>(c));
+                    escaped += buf;
+                } else {
+                    escaped += c;
+                }
         }
     }
+    return escaped;
+}
 
-    std::cout << "[INFO] 最終サイクル数: " << totalCycles << "\n";
-    std::cout << "[INFO] 表示フレーム数: " << frameCount << "\n";
-    //display.close();
+void RunResult::writeJSON(std::ostream& out) const {
+    // 実機のCPUクロック（4.194304MHz）に対する倍率も出しておく
+    const double wall = wallSeconds > 0 ? wallSeconds : 1e-9;
+    char hash[32];
+    std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(frameHash));
+
+    const std::ios::fmtflags savedFlags = out.flags();
+    out << std::dec << "{\"exit_reason\":\"" << escapeJSON(exitReason) << "\""
+        << ",\"cycles\":" << cycles
+        << ",\"frames\":" << frames
+        << ",\"instructions\":" << instructions
+        << ",\"wall_seconds\":" << wallSeconds
+        << ",\"emulated_mhz\":" << (cycles / wall / 1e6)
+        << ",\"speed_multiplier\":" << (cycles / wall / 4194304.0)
+        << ",\"frames_per_second\":" << (frames / wall)
+        << ",\"instructions_per_second\":" << (instructions / wall)
+        << ",\"frame_hash\":\"" << hash << "\""
+        << ",\"serial\":\"" << escapeJSON(serialOutput) << "\"}";
+    out.flags(savedFlags);
 }
@@ -0,0 +1,155 @@
+#include "farm.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+
+namespace {
+std::string escapeXML(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        switch (c) {
+            case '&':  escaped += "&amp;"; break;
+            case '<':  escaped += "&lt;"; break;
+            case '>':  escaped += "&gt;"; break;
+            case '"':  escaped += "&quot;"; break;
+            default:
+                // XML 1.0で使えない制御文字は落とす
+                if (static_cast<unsigned char>(c) >= 0x20 || c == '\n' || c == '\t') {
+                    escaped += c;
+                }
+        }
+    }
+    return escaped;
+}
+
+std::string testName(const std::string& romPath) {
+    return std::filesystem::path(romPath).stem().string();
+}
+
+FarmResult runJob(const FarmJob& job) {
+    FarmResult result;
+    result.romPath = job.romPath;
+
+    // インスタンスは完全に独立（グローバル/静的状態なし）なのでスレッドごとに作るだけでよい
+    auto emu = std::make_unique<Emulator>();
+    emu->setRenderMode(job.renderMode, job.renderInterval);
+    if (!emu->loadROM(job.romPath)) {
+        result.status = "error";
+        result.run.exitReason = "load_failed";
+        return result;
+    }
+
+    result.run = emu->run(job.options);
+    if (result.run.exitReason == "serial:Passed" || result.run.exitReason == "frame_hash") {
+        result.status = "passed";
+    } else if (result.run.exitReason == "serial:Failed") {
+        result.status = "failed";
+    } else {
+        result.status = "no_result";   // 予算切れ/無限ループ（シリアルでの判定なし）
+    }
+    return result;
+}
+}
+
+std::vector<std::string> collectROMs(const std::vector<std::string>& paths) {
+    namespace fs = std::filesystem;
+    std::vector<std::string> roms;
+    for (const std::string& path : paths) {
+        std::error_code ec;
+        if (!fs::is_directory(path, ec)) {
+            roms.push_back(path);
+            continue;
+        }
+        std::vector<std::string> found;
+        for (const fs::directory_entry& entry : fs::directory_iterator(path, ec)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".gb") {
+                found.push_back(entry.path().string());
+            }
+        }
+        std::sort(found.begin(), found.end());
+        roms.insert(roms.end(), found.begin(), found.end());
+    }
+    return roms;
+}
+
+FarmReport runFarm(const std::vector<FarmJob>& jobs, size_t threads) {
+    FarmReport report;
+    report.results.resize(jobs.size());
+    const auto wallStart = std::chrono::steady_clock::now();
+
+    {
+        ThreadPool pool(threads);
+        report.threads = pool.size();
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            // 各タスクは自分の結果スロットにだけ書く
+            pool.submit([&jobs, &report, i] { report.results[i] = runJob(jobs[i]); });
+        }
+        pool.wait();
+    }
+
+    report.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    return report;
+}
+
+size_t FarmReport::count(const std::string& status) const {
+    return std::count_if(results.begin(), results.end(),
+                         [&status](const FarmResult& r) { return r.status == status; });
+}
+
+void FarmReport::writeJSON(std::ostream& out) const {
+    uint64_t totalCycles = 0;
+    for (const FarmResult& r : results) {
+        totalCycles += r.run.cycles;
+    }
+    const double wall = wallSeconds > 0 ? wallSeconds : 1e-9;
+
+    const std::ios::fmtflags savedFlags = out.flags();
+    out << std::dec << "{\"threads\":" << threads
+        << ",\"wall_seconds\":" << wallSeconds
+        << ",\"total\":" << results.size()
+        << ",\"passed\":" << count("passed")
+        << ",\"failed\":" << count("failed")
+        << ",\"no_result\":" << count("no_result")
+        << ",\"errors\":" << count("error")
+        << ",\"total_cycles\":" << totalCycles
+        << ",\"aggregate_mhz\":" << (totalCycles / wall / 1e6)
+        << ",\"results\":[";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const FarmResult& r = results[i];
+        out << (i ? "," : "")
+            << "{\"name\":\"" << escapeJSON(testName(r.romPath)) << "\""
+            << ",\"rom\":\"" << escapeJSON(r.romPath) << "\""
+            << ",\"status\":\"" << r.status << "\""
+            << ",\"run\":";
+        r.run.writeJSON(out);
+        out << "}";
+    }
+    out << "]}";
+    out.flags(savedFlags);
+}
+
+void FarmReport::writeJUnit(std::ostream& out) const {
+    // 判定なし(no_result)とロード失敗はerror、Failedはfailureとして扱う
+    const std::ios::fmtflags savedFlags = out.flags();
+    out << std::dec << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        << "<testsuite name=\"gameboy-roms\" tests=\"" << results.size()
+        << "\" failures=\"" << count("failed")
+        << "\" errors=\"" << (count("no_result") + count("error"))
+        << "\" time=\"" << wallSeconds << "\">\n";
+    for (const FarmResult& r : results) {
+        out << "  <testcase classname=\"roms\" name=\"" << escapeXML(testName(r.romPath))
+            << "\" time=\"" << r.run.wallSeconds << "\">\n";
+        if (r.status == "failed") {
+            out << "    <failure message=\"" << escapeXML(r.run.exitReason) << "\"/>\n";
+        } else if (r.status != "passed") {
+            out << "    <error message=\"" << escapeXML(r.run.exitReason) << "\"/>\n";
+        }
+        out << "    <system-out>cycles=" << r.run.cycles << " frames=" << r.run.frames
+            << "\n" << escapeXML(r.run.serialOutput) << "</system-out>\n"
+            << "  </testcase>\n";
+    }
+    out << "</testsuite>\n";
+    out.flags(savedFlags);
+}
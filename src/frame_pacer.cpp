@@ -0,0 +1,96 @@
+#include "frame_pacer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace {
+// この時間より手前まではスリープし、残りをスピンで待つ（OSのスリープ粒度対策）
+constexpr auto SPIN_MARGIN = std::chrono::milliseconds(2);
+// これ以上遅れたら追いつこうとせず期限を今から数え直す
+constexpr int MAX_LAG_FRAMES = 3;
+
+void record(std::vector<double>& ring, size_t& index, size_t capacity, double value) {
+    if (ring.size() < capacity) {
+        ring.push_back(value);
+    } else {
+        ring[index] = value;
+    }
+    index = (index + 1) % capacity;
+}
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0.0;
+    size_t rank = static_cast<size_t>(std::ceil(p * values.size()));
+    rank = std::min(std::max<size_t>(rank, 1), values.size()) - 1;
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank];
+}
+}
+
+FramePacer::FramePacer(double speed)
+    : speed(speed) {}
+
+void FramePacer::reset() {
+    started = false;
+    frameTimes.clear();
+    jitters.clear();
+    frameIndex = 0;
+    jitterIndex = 0;
+}
+
+FramePacer::Clock::duration FramePacer::period() const {
+    return std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / (GB_FRAME_RATE * speed)));
+}
+
+void FramePacer::waitForNextFrame() {
+    Clock::time_point now = Clock::now();
+    if (!started) {
+        started = true;
+        lastFrame = now;
+        deadline = now;
+    }
+
+    const bool capped = !isUncapped();
+    if (capped) {
+        deadline += period();
+        if (now - deadline > period() * MAX_LAG_FRAMES) {
+            deadline = now;  // 大きく遅れた（ブレークポイント等）: 取り戻さない
+        }
+        if (deadline - now > SPIN_MARGIN) {
+            std::this_thread::sleep_for(deadline - now - SPIN_MARGIN);
+        }
+        while (Clock::now() < deadline) {
+            // スピン
+        }
+        now = Clock::now();
+    } else {
+        deadline = now;  // 制限に戻った時はそこから数える
+    }
+
+    const double frameMs = std::chrono::duration<double, std::milli>(now - lastFrame).count();
+    lastFrame = now;
+    record(frameTimes, frameIndex, HISTORY, frameMs);
+    if (capped) {
+        const double targetMs = std::chrono::duration<double, std::milli>(period()).count();
+        record(jitters, jitterIndex, HISTORY, std::abs(frameMs - targetMs));
+    }
+}
+
+FramePacer::Stats FramePacer::getStats() const {
+    Stats stats;
+    stats.frames = frameTimes.size();
+    if (frameTimes.empty()) return stats;
+
+    double total = 0.0;
+    for (double t : frameTimes) total += t;
+    stats.meanMs = total / frameTimes.size();
+    stats.fps = stats.meanMs > 0 ? 1000.0 / stats.meanMs : 0.0;
+    stats.p50Ms = percentile(frameTimes, 0.50);
+    stats.p90Ms = percentile(frameTimes, 0.90);
+    stats.p99Ms = percentile(frameTimes, 0.99);
+    stats.maxMs = *std::max_element(frameTimes.begin(), frameTimes.end());
+    stats.jitterP50Ms = percentile(jitters, 0.50);
+    stats.jitterP99Ms = percentile(jitters, 0.99);
+    return stats;
+}
@@ -0,0 +1,137 @@
+#include "framebuffer.hpp"
+#include <array>
+#include <cstring>
+
+namespace {
+
+// シェード番号 → 各形式の色
+constexpr uint32_t SHADE_ARGB[4] = { 0xFFFFFFFF, 0xFFBFBFBF, 0xFF7F7F7F, 0xFF1F1F1F };
+constexpr uint8_t  SHADE_GRAY[4] = { 0xFF, 0xBF, 0x7F, 0x1F };
+
+constexpr uint16_t toRGB565(uint8_t g) {
+    return static_cast<uint16_t>(((g >> 3) << 11) | ((g >> 2) << 5) | (g >> 3));
+}
+
+// 詰められた1バイト(4ピクセル) → 4ピクセル分の出力をまとめて引く展開表。
+// 1バイト入力につき16/8/4バイトを一括で書けるので、変換は表引き＋幅広ストアになる。
+template <typename T>
+struct ExpandTable {
+    std::array<std::array<T, 4>, 256> entries{};
+};
+
+constexpr ExpandTable<uint32_t> makeARGBTable() {
+    ExpandTable<uint32_t> t{};
+    for (int b = 0; b < 256; ++b) {
+        for (int p = 0; p < 4; ++p) {
+            t.entries[b][p] = SHADE_ARGB[(b >> (p * 2)) & 0x03];
+        }
+    }
+    return t;
+}
+
+constexpr ExpandTable<uint16_t> makeRGB565Table() {
+    ExpandTable<uint16_t> t{};
+    for (int b = 0; b < 256; ++b) {
+        for (int p = 0; p < 4; ++p) {
+            t.entries[b][p] = toRGB565(SHADE_GRAY[(b >> (p * 2)) & 0x03]);
+        }
+    }
+    return t;
+}
+
+constexpr ExpandTable<uint8_t> makeGrayTable() {
+    ExpandTable<uint8_t> t{};
+    for (int b = 0; b < 256; ++b) {
+        for (int p = 0; p < 4; ++p) {
+            t.entries[b][p] = SHADE_GRAY[(b >> (p * 2)) & 0x03];
+        }
+    }
+    return t;
+}
+
+constexpr auto ARGB_TABLE   = makeARGBTable();
+constexpr auto RGB565_TABLE = makeRGB565Table();
+constexpr auto GRAY_TABLE   = makeGrayTable();
+
+template <typename Table>
+void expandLine(const uint8_t* packedLine, uint8_t* out, const Table& table) {
+    constexpr size_t CHUNK = sizeof(table.entries[0]);
+    for (int i = 0; i < FRAME_LINE_BYTES; ++i) {
+        std::memcpy(out + i * CHUNK, table.entries[packedLine[i]].data(), CHUNK);
+    }
+}
+
+} // namespace
+
+int bytesPerPixel(PixelFormat fmt) {
+    switch (fmt) {
+        case PixelFormat::ARGB8888: return 4;
+        case PixelFormat::RGB565:   return 2;
+        case PixelFormat::Gray8:    return 1;
+    }
+    return 4;
+}
+
+uint64_t hashFrameLine(const uint8_t* packedLine) {
+    // 40バイト = 64bit×5 語をまとめて混ぜる（バイト順に依存しないよう明示的に組み立てる）
+    uint64_t h = 0x9E3779B97F4A7C15ULL;
+    for (int w = 0; w < FRAME_LINE_BYTES / 8; ++w) {
+        uint64_t v = 0;
+        for (int i = 0; i < 8; ++i) {
+            v |= static_cast<uint64_t>(packedLine[w * 8 + i]) << (i * 8);
+        }
+        h ^= v;
+        h *= 0xBF58476D1CE4E5B9ULL;
+        h ^= h >> 31;
+    }
+    return h;
+}
+
+uint64_t combineLineHashes(const uint64_t* lineHashes) {
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (int y = 0; y < SCREEN_HEIGHT; ++y) {
+        h ^= lineHashes[y];
+        h *= 0x100000001B3ULL;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+void convertFrameLine(const uint8_t* packedLine, void* dst, PixelFormat fmt) {
+    uint8_t* out = static_cast<uint8_t*>(dst);
+    switch (fmt) {
+        case PixelFormat::ARGB8888: expandLine(packedLine, out, ARGB_TABLE);   break;
+        case PixelFormat::RGB565:   expandLine(packedLine, out, RGB565_TABLE); break;
+        case PixelFormat::Gray8:    expandLine(packedLine, out, GRAY_TABLE);   break;
+    }
+}
+
+void convertFrame(const uint8_t* frame, void* dst, int pitch, PixelFormat fmt) {
+    if (pitch <= 0) {
+        pitch = SCREEN_WIDTH * bytesPerPixel(fmt);
+    }
+    uint8_t* out = static_cast<uint8_t*>(dst);
+    for (int y = 0; y < SCREEN_HEIGHT; ++y) {
+        convertFrameLine(frame + y * FRAME_LINE_BYTES, out + y * pitch, fmt);
+    }
+}
+
+int syncFrameTarget(const uint8_t* frame, const uint64_t* frameLineHashes, const FrameTarget& target) {
+    if (!target.pixels) {
+        return 0;
+    }
+    const int pitch = target.pitch > 0 ? target.pitch : SCREEN_WIDTH * bytesPerPixel(target.format);
+    uint8_t* out = static_cast<uint8_t*>(target.pixels);
+    int written = 0;
+    for (int y = 0; y < SCREEN_HEIGHT; ++y) {
+        if (target.lineHashes && target.lineHashes[y] == frameLineHashes[y]) {
+            continue;
+        }
+        convertFrameLine(frame + y * FRAME_LINE_BYTES, out + y * pitch, target.format);
+        if (target.lineHashes) {
+            target.lineHashes[y] = frameLineHashes[y];
+        }
+        ++written;
+    }
+    return written;
+}
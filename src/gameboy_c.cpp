@@ -0,0 +1,149 @@
+#include "gameboy_c.h"
+#include "emulator.hpp"
+#include "vec_emulator.hpp"
+#include <cstring>
+#include <vector>
+
+// Cのハンドルの中身（保存用の作業バッファも持たせて毎回の確保を避ける）
+struct gb_emulator {
+    Emulator emu;
+    std::vector<uint8_t> stateBuffer;
+};
+
+uint32_t gb_api_version(void) {
+    return GB_API_VERSION;
+}
+
+gb_emulator* gb_create(void) {
+    return new gb_emulator();
+}
+
+void gb_destroy(gb_emulator* gb) {
+    delete gb;
+}
+
+int gb_load_rom(gb_emulator* gb, const uint8_t* data, size_t size) {
+    return gb->emu.loadROMData(data, size) ? 0 : -1;
+}
+
+int gb_load_rom_file(gb_emulator* gb, const char* path) {
+    return gb->emu.loadROM(path) ? 0 : -1;
+}
+
+void gb_run_frame(gb_emulator* gb) {
+    gb->emu.runFrame();
+}
+
+void gb_run_cycles(gb_emulator* gb, uint64_t cycles) {
+    gb->emu.runCycles(cycles);
+}
+
+uint64_t gb_cycle_count(const gb_emulator* gb) {
+    return gb->emu.getCycleCount();
+}
+
+void gb_set_render_mode(gb_emulator* gb, int mode, int interval) {
+    PPU::RenderMode renderMode = PPU::RenderMode::Full;
+    if (mode == GB_RENDER_EVERY_NTH) renderMode = PPU::RenderMode::EveryNth;
+    else if (mode == GB_RENDER_TIMING_ONLY) renderMode = PPU::RenderMode::TimingOnly;
+    gb->emu.setRenderMode(renderMode, interval);
+}
+
+void gb_set_input(gb_emulator* gb, uint8_t buttons) {
+    gb->emu.setButtonMask(buttons);
+}
+
+const uint8_t* gb_get_framebuffer(const gb_emulator* gb) {
+    return gb->emu.getFrameBuffer();
+}
+
+size_t gb_framebuffer_size(void) {
+    return FRAME_BYTES;
+}
+
+void gb_copy_frame(const gb_emulator* gb, void* dst, int pitch, int format) {
+    PixelFormat fmt = PixelFormat::ARGB8888;
+    if (format == GB_PIXEL_RGB565) fmt = PixelFormat::RGB565;
+    else if (format == GB_PIXEL_GRAY8) fmt = PixelFormat::Gray8;
+    gb->emu.copyFrame(dst, pitch, fmt);
+}
+
+uint64_t gb_frame_hash(const gb_emulator* gb) {
+    return gb->emu.getFrameHash();
+}
+
+uint8_t gb_read_memory(gb_emulator* gb, uint16_t addr) {
+    return gb->emu.readByte(addr);
+}
+
+void gb_write_memory(gb_emulator* gb, uint16_t addr, uint8_t value) {
+    gb->emu.writeByte(addr, value);
+}
+
+size_t gb_save_state(gb_emulator* gb, uint8_t* buffer, size_t capacity) {
+    gb->emu.saveState(gb->stateBuffer);
+    if (buffer && capacity >= gb->stateBuffer.size()) {
+        std::memcpy(buffer, gb->stateBuffer.data(), gb->stateBuffer.size());
+    }
+    return gb->stateBuffer.size();
+}
+
+int gb_load_state(gb_emulator* gb, const uint8_t* data, size_t size) {
+    return gb->emu.loadState(data, size) ? 0 : -1;
+}
+
+struct gb_vec {
+    VecEmulator vec;
+    gb_vec(size_t envCount, size_t threads) : vec(envCount, threads) {}
+};
+
+gb_vec* gb_vec_create(size_t env_count, size_t threads) {
+    return new gb_vec(env_count, threads);
+}
+
+void gb_vec_destroy(gb_vec* vec) {
+    delete vec;
+}
+
+int gb_vec_load_rom_file(gb_vec* vec, const char* path, uint64_t warmup_frames) {
+    return vec->vec.loadROM(path, warmup_frames) ? 0 : -1;
+}
+
+int gb_vec_set_start_state(gb_vec* vec, const uint8_t* data, size_t size) {
+    return vec->vec.setStartState(data, size) ? 0 : -1;
+}
+
+void gb_vec_set_observation(gb_vec* vec, int type) {
+    ObservationType observation = ObservationType::PackedFrame;
+    if (type == GB_OBS_GRAY8) observation = ObservationType::Gray8Frame;
+    else if (type == GB_OBS_RAM) observation = ObservationType::RAM;
+    vec->vec.setObservation(observation);
+}
+
+size_t gb_vec_observation_size(const gb_vec* vec) {
+    return vec->vec.observationSize();
+}
+
+void gb_vec_set_episode_frames(gb_vec* vec, uint64_t frames) {
+    vec->vec.setEpisodeFrames(frames);
+}
+
+void gb_vec_set_lockstep(gb_vec* vec, int enabled) {
+    vec->vec.setLockstep(enabled != 0);
+}
+
+void gb_vec_reset(gb_vec* vec, uint8_t* observations) {
+    vec->vec.reset(observations);
+}
+
+void gb_vec_step(gb_vec* vec, const uint8_t* actions, uint8_t* observations, uint8_t* dones) {
+    vec->vec.step(actions, observations, dones);
+}
+
+double gb_vec_last_fps(const gb_vec* vec) {
+    return vec->vec.getStats().lastFramesPerSecond;
+}
+
+double gb_vec_average_fps(const gb_vec* vec) {
+    return vec->vec.getStats().averageFramesPerSecond();
+}
@@ -1,4 +1,5 @@
 #include "input.hpp"
+#include "savestate.hpp"
 #include <iostream>
 
 Input::Input()
@@ -42,6 +43,15 @@ void Input::setButtonPressed(JoypadButton button, bool pressed) {
     }
 }
 
+uint8_t Input::getButtonMask() const {
+    return static_cast<uint8_t>(~((buttonStates & 0x0F) | ((directionStates & 0x0F) << 4)));
+}
+
+void Input::setButtonMask(uint8_t mask) {
+    buttonStates    = 0xF0 | (~mask & 0x0F);
+    directionStates = 0xF0 | ((~mask >> 4) & 0x0F);
+}
+
 void Input::setJoypadRegister(uint8_t value) {
     // CPU が P1 レジスタ(0xFF00)に書いた値を保持
     joypadRegister = value;
@@ -72,3 +82,17 @@ uint8_t Input::getJoypadState() const {
 
     return result;
 }
+
+void Input::saveState(StateWriter& out) const {
+    out.writeTag("JOYP");
+    out.write8(buttonStates);
+    out.write8(directionStates);
+    out.write8(joypadRegister);
+}
+
+void Input::loadState(StateReader& in) {
+    if (!in.expectTag("JOYP")) return;
+    buttonStates = in.read8();
+    directionStates = in.read8();
+    joypadRegister = in.read8();
+}
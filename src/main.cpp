@@ -1,18 +1,384 @@
 #include "emulator.hpp"
+#include "farm.hpp"
+#include "movie.hpp"
+#include "sdl_frontend.hpp"
+#include "vec_emulator.hpp"
 #include <iostream>
 #include <string>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+namespace {
+void printUsage(const char* prog) {
+    std::cout << "Usage: " << prog << " [options] [rom.gb]\n"
+              << "       " << prog << " --farm [options] [rom.gb|dir ...]\n"
+              << "  --headless             ウィンドウなしで実行し、終了時に計測値をJSONで出力\n"
+              << "  --max-frames N         Nフレームで終了（ヘッドレス）\n"
+              << "  --max-cycles N         Nサイクルで終了（ヘッドレス）\n"
+              << "  --exit-on-serial STR   シリアル出力がSTRで終わったら終了（複数指定可）\n"
+              << "  --exit-on-loop         抜け出せない無限ループ/HALTを検出したら終了\n"
+              << "  --exit-on-frame-hash H フレーム境界で画面ハッシュ（16進）がHになったら終了（複数指定可）\n"
+              << "  --expect REASON        終了理由がREASON（例: serial:Passed, frame_hash）でなければ終了コード1\n"
+              << "  --save-frame PATH      終了時の画面をPPMで保存（ヘッドレス）\n"
+              << "  --frameskip N          Nフレームに1回だけ描画（タイミングは通常通り）\n"
+              << "  --no-render            描画を完全に省略（STAT/LY/割り込みのみ）\n"
+              << "  --trace                命令トレースを標準出力へ\n"
+              << "  --timeline PATH        ゲーム内/ホストの出来事をChrome trace形式のJSONに記録して終了時に保存\n"
+              << "  --profile              終了時にサブシステム別の時間をJSONで標準エラーへ（GAMEBOY_PROFILEビルド）\n"
+              << "  --load-state PATH      ROM読み込み後にセーブステートを復元\n"
+              << "  --save-state PATH      終了時にセーブステートを保存（ヘッドレス）\n"
+              << "  --speed X              表示速度の倍率（既定1.0=59.7275Hz, 0で無制限）。Tab押下中は無制限\n"
+              << "  --rewind-mb N          巻き戻し履歴の容量（MB, 0で無効, 既定64）。Backspaceで巻き戻し\n"
+              << "  --run-ahead N          入力をNフレーム先まで先読みして表示（遅延を隠す。既定0）\n"
+              << "  --record-movie PATH    ウィンドウ実行中の入力をムービーとして記録\n"
+              << "  --play-movie PATH      ムービーをウィンドウなしで最速再生し、同期を検証\n"
+              << "  --verify-savestate     フレーム途中で保存→別インスタンスへ復元し、以後600フレームを比較\n"
+              << "  --farm                 複数ROMを並列実行してレポートを出す（既定: roms/）\n"
+              << "  --jobs N               ファームのスレッド数（既定: CPUコア数）\n"
+              << "  --json PATH            ファームのJSONレポートをファイルへ（既定: 標準出力）\n"
+              << "  --junit PATH           ファームのJUnit XMLレポートをファイルへ\n"
+              << "  --vec-bench N          N環境の並列ステップを独立実行とロックステップで比較（--jobs, --max-frames）\n"
+              << "  --vec-policy P         --vec-benchの行動: idle（全環境入力なし）/ random（毎フレーム乱択）\n";
+}
+
+// セーブステートの往復検証: フレーム途中で保存し、新しいインスタンスへ復元して
+// 以後のフレームハッシュと最終状態が元のインスタンスと一致するかを調べる
+int verifySaveState(const std::string& romPath, uint64_t savePoint,
+                    PPU::RenderMode renderMode, int renderInterval) {
+    constexpr int COMPARE_FRAMES = 600;
+    using Clock = std::chrono::steady_clock;
+
+    auto original = std::make_unique<Emulator>();
+    auto restored = std::make_unique<Emulator>();
+    for (Emulator* emu : {original.get(), restored.get()}) {
+        emu->setRenderMode(renderMode, renderInterval);
+        if (!emu->loadROM(romPath)) {
+            return 1;
+        }
+    }
+
+    RunOptions warmup;
+    warmup.maxCycles = savePoint;
+    original->run(warmup);
+
+    std::vector<uint8_t> state;
+    const auto saveStart = Clock::now();
+    original->saveState(state);
+    const auto saveEnd = Clock::now();
+    const bool loaded = restored->loadState(state.data(), state.size());
+    const auto loadEnd = Clock::now();
+
+    // 復元直後に保存し直しても同じバイト列になること
+    std::vector<uint8_t> resaved;
+    restored->saveState(resaved);
+    bool match = loaded && resaved == state;
+
+    int firstMismatch = -1;
+    RunOptions oneFrame;
+    oneFrame.maxFrames = 1;
+    for (int frame = 0; match && frame < COMPARE_FRAMES; ++frame) {
+        original->run(oneFrame);
+        restored->run(oneFrame);
+        if (original->getFrameHash() != restored->getFrameHash()) {
+            firstMismatch = frame;
+            match = false;
+        }
+    }
+    if (match) {
+        original->saveState(state);
+        restored->saveState(resaved);
+        match = resaved == state;
+    }
+
+    auto micros = [](Clock::duration d) { return std::chrono::duration<double, std::micro>(d).count(); };
+    std::cout << "{\"rom\":\"" << escapeJSON(romPath) << "\""
+              << ",\"save_point_cycles\":" << savePoint
+              << ",\"state_bytes\":" << state.size()
+              << ",\"save_us\":" << micros(saveEnd - saveStart)
+              << ",\"load_us\":" << micros(loadEnd - saveEnd)
+              << ",\"frames_compared\":" << COMPARE_FRAMES
+              << ",\"first_mismatch\":" << firstMismatch
+              << ",\"match\":" << (match ? "true" : "false") << "}" << std::endl;
+    return match ? 0 : 1;
+}
+
+// 並列環境の比較: 同じ行動列で「全環境を個別に実行」と「ロックステップ」を走らせ、
+// 全環境合計の命令/秒と、最後に全環境の状態が両者で一致するかを出す
+int benchVecEmulator(const std::string& romPath, size_t envCount, size_t threads, uint64_t steps,
+                     bool randomPolicy, bool renderFrames) {
+    std::vector<uint64_t> finalHashes[2];
+    for (int mode = 0; mode < 2; ++mode) {
+        VecEmulator vec(envCount, threads);
+        vec.setObservation(renderFrames ? ObservationType::PackedFrame : ObservationType::RAM);
+        if (!vec.loadROM(romPath)) {
+            return 1;
+        }
+        vec.setLockstep(mode == 1);
+        vec.reset(nullptr);
+
+        std::vector<uint8_t> observations(envCount * vec.observationSize());
+        std::vector<uint8_t> actions(envCount, 0);
+        uint64_t seed = 0x9E3779B97F4A7C15ULL;
+        for (uint64_t step = 0; step < steps; ++step) {
+            if (randomPolicy) {
+                for (uint8_t& action : actions) {
+                    seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+                    const int choice = static_cast<int>(seed % 9);
+                    action = choice == 0 ? 0 : static_cast<uint8_t>(1 << (choice - 1));
+                }
+            }
+            vec.step(actions.data(), observations.data(), nullptr);
+        }
+        for (size_t i = 0; i < envCount; ++i) {
+            finalHashes[mode].push_back(vec.env(i).getStateHash());
+        }
+
+        const VecStats& stats = vec.getStats();
+        std::cout << "{\"mode\":\"" << (mode == 1 ? "lockstep" : "independent") << "\""
+                  << ",\"envs\":" << envCount
+                  << ",\"threads\":" << vec.threadCount()
+                  << ",\"steps\":" << stats.steps
+                  << ",\"env_frames\":" << stats.envFrames
+                  << ",\"executed_frames\":" << stats.executedFrames
+                  << ",\"instructions\":" << stats.instructions
+                  << ",\"executed_instructions\":" << stats.executedInstructions
+                  << ",\"wall_seconds\":" << stats.totalStepSeconds
+                  << ",\"frames_per_second\":" << stats.averageFramesPerSecond()
+                  << ",\"instructions_per_second\":" << stats.instructionsPerSecond() << "}" << std::endl;
+    }
+    const bool identical = finalHashes[0] == finalHashes[1];
+    std::cout << "{\"identical\":" << (identical ? "true" : "false") << "}" << std::endl;
+    return identical ? 0 : 1;
+}
+}
 
 int main(int argc, char* argv[]) {
     Emulator emu;                            // エミュレータ本体を作成
 
-    std::string romPath = "../roms/bgbtest.gb";
-    if (argc > 1) {
-        romPath = argv[1];
+    std::vector<std::string> romPaths;
+    bool headless = false;
+    FrontendOptions frontendOptions;
+    RunOptions options;
+    PPU::RenderMode renderMode = PPU::RenderMode::Full;
+    int renderInterval = 1;
+    bool farm = false;
+    size_t farmThreads = 0;
+    std::string jsonPath;
+    std::string junitPath;
+    std::string loadStatePath;
+    std::string saveStatePath;
+    bool verifyState = false;
+    std::string playMoviePath;
+    size_t vecEnvs = 0;
+    bool vecRandom = false;
+    std::string expectedReason;
+    bool printProfile = false;
+    std::string timelinePath;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg == "--headless") {
+            headless = true;
+        } else if (arg == "--max-frames" && hasValue) {
+            options.maxFrames = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--max-cycles" && hasValue) {
+            options.maxCycles = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--exit-on-serial" && hasValue) {
+            options.exitOnSerial.push_back(argv[++i]);
+        } else if (arg == "--exit-on-frame-hash" && hasValue) {
+            options.exitOnFrameHash.push_back(std::strtoull(argv[++i], nullptr, 16));
+        } else if (arg == "--expect" && hasValue) {
+            expectedReason = argv[++i];
+        } else if (arg == "--exit-on-loop") {
+            options.exitOnLoop = true;
+        } else if (arg == "--save-frame" && hasValue) {
+            options.saveFramePath = argv[++i];
+        } else if (arg == "--frameskip" && hasValue) {
+            renderMode = PPU::RenderMode::EveryNth;
+            renderInterval = std::atoi(argv[++i]);
+        } else if (arg == "--no-render") {
+            renderMode = PPU::RenderMode::TimingOnly;
+        } else if (arg == "--timeline" && hasValue) {
+            timelinePath = argv[++i];
+        } else if (arg == "--profile") {
+            printProfile = true;
+        } else if (arg == "--trace") {
+            emu.setTraceOutput(&std::cout);
+        } else if (arg == "--load-state" && hasValue) {
+            loadStatePath = argv[++i];
+        } else if (arg == "--save-state" && hasValue) {
+            saveStatePath = argv[++i];
+        } else if (arg == "--speed" && hasValue) {
+            frontendOptions.speed = std::atof(argv[++i]);
+        } else if (arg == "--rewind-mb" && hasValue) {
+            frontendOptions.rewindBytes = std::strtoull(argv[++i], nullptr, 10) * 1024 * 1024;
+        } else if (arg == "--run-ahead" && hasValue) {
+            frontendOptions.runAheadFrames = std::atoi(argv[++i]);
+        } else if (arg == "--record-movie" && hasValue) {
+            frontendOptions.movieRecordPath = argv[++i];
+        } else if (arg == "--play-movie" && hasValue) {
+            playMoviePath = argv[++i];
+        } else if (arg == "--verify-savestate") {
+            verifyState = true;
+        } else if (arg == "--farm") {
+            farm = true;
+        } else if (arg == "--jobs" && hasValue) {
+            farmThreads = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--json" && hasValue) {
+            jsonPath = argv[++i];
+        } else if (arg == "--junit" && hasValue) {
+            junitPath = argv[++i];
+        } else if (arg == "--vec-bench" && hasValue) {
+            vecEnvs = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--vec-policy" && hasValue) {
+            vecRandom = std::string(argv[++i]) == "random";
+        } else if (!arg.empty() && arg[0] == '-') {
+            std::cerr << "Unknown option: " << arg << "\n";
+            printUsage(argv[0]);
+            return 2;
+        } else {
+            romPaths.push_back(arg);
+        }
     }
 
-    std::cout << "Loading ROM: " << romPath << std::endl;
-    emu.loadROM(romPath);                    // ROMを読み込み+CPU初期化
+    if (farm) {
+        // 判定はblarggテストのシリアル出力。予算の既定はエミュレーション時間で2分
+        if (options.exitOnSerial.empty()) {
+            options.exitOnSerial = {"Passed", "Failed"};
+        }
+        if (options.maxCycles == 0 && options.maxFrames == 0) {
+            options.maxCycles = 120ULL * 4194304;
+        }
+        std::vector<FarmJob> jobs;
+        for (const std::string& rom : collectROMs(romPaths.empty() ? std::vector<std::string>{"roms"} : romPaths)) {
+            jobs.push_back({rom, options, renderMode, renderInterval});
+        }
+
+        FarmReport report = runFarm(jobs, farmThreads);
+        // 標準出力はJSONレポートだけにする（途中経過は標準エラーへ）
+        for (const FarmResult& r : report.results) {
+            std::cerr << "[" << r.status << "] " << r.romPath << " (" << r.run.exitReason
+                      << ", " << r.run.cycles << " cycles, " << r.run.wallSeconds << " s)\n";
+        }
+        if (!junitPath.empty()) {
+            std::ofstream junit(junitPath);
+            report.writeJUnit(junit);
+        }
+        if (!jsonPath.empty()) {
+            std::ofstream json(jsonPath);
+            report.writeJSON(json);
+            json << "\n";
+        } else {
+            report.writeJSON(std::cout);
+            std::cout << std::endl;
+        }
+        return report.allPassed() ? 0 : 1;
+    }
+
+    emu.setRenderMode(renderMode, renderInterval);
+    const std::string romPath = romPaths.empty() ? "../roms/bgbtest.gb" : romPaths.back();
+
+    if (vecEnvs > 0) {
+        return benchVecEmulator(romPath, vecEnvs, farmThreads, options.maxFrames ? options.maxFrames : 600,
+                                vecRandom, renderMode != PPU::RenderMode::TimingOnly);
+    }
+
+    if (verifyState) {
+        // 既定の保存位置は60.5フレーム目（フレーム途中）
+        uint64_t savePoint = options.maxCycles ? options.maxCycles : Emulator::FRAME_CYCLES * 121 / 2;
+        return verifySaveState(romPath, savePoint, renderMode, renderInterval);
+    }
+
+#ifndef GAMEBOY_HAS_SDL
+    if (!headless) {
+        std::cerr << "Built without SDL2: running headless\n";
+        headless = true;
+    }
+#endif
+
+    if (!headless) {
+        std::cout << "Loading ROM: " << romPath << std::endl;
+    }
+    if (!emu.loadROM(romPath)) {             // ROMを読み込み+CPU初期化
+        return 1;
+    }
+    if (!loadStatePath.empty() && !emu.loadStateFile(loadStatePath)) {
+        return 1;
+    }
+
+    // タイムライン記録: 実行が終わってからまとめて書き出す
+    std::unique_ptr<TimelineRecorder> timeline;
+    if (!timelinePath.empty()) {
+        timeline = std::make_unique<TimelineRecorder>();
+        emu.setTimeline(timeline.get());
+    }
+    auto saveTimeline = [&] {
+        if (!timeline) return;
+        emu.setTimeline(nullptr);
+        if (timeline->writeJSON(timelinePath)) {
+            std::cerr << "[TIMELINE] " << timeline->eventCount() << " events ("
+                      << timeline->droppedCount() << " dropped) -> " << timelinePath << std::endl;
+        }
+    };
+
+    if (!playMoviePath.empty()) {
+        // ムービー再生: 記録時の状態ハッシュと毎フレーム突き合わせる
+        Movie movie;
+        if (!movie.load(playMoviePath)) {
+            return 1;
+        }
+        MovieReplay replay = replayMovie(emu, movie);
+        saveTimeline();
+        const double wall = replay.wallSeconds > 0 ? replay.wallSeconds : 1e-9;
+        std::cout << "{\"movie\":\"" << escapeJSON(playMoviePath) << "\""
+                  << ",\"started\":" << (replay.started ? "true" : "false")
+                  << ",\"inputs\":" << movie.inputs.size()
+                  << ",\"checkpoints\":" << movie.checkpoints.size()
+                  << ",\"verified\":" << replay.checkpointsVerified
+                  << ",\"desync_checkpoint\":" << replay.desyncCheckpoint
+                  << ",\"in_sync\":" << (replay.inSync() ? "true" : "false")
+                  << ",\"cycles\":" << replay.cycles
+                  << ",\"wall_seconds\":" << replay.wallSeconds
+                  << ",\"speed_multiplier\":" << (replay.cycles / wall / 4194304.0) << "}" << std::endl;
+        return replay.inSync() ? 0 : 1;
+    }
+
+    if (headless) {
+        // CI/ファーム用: 終了条件まで最速で回し、最後に1行JSONを出す
+        RunResult result = emu.run(options);
+        saveTimeline();
+        result.writeJSON(std::cout);
+        std::cout << std::endl;
+        if (printProfile) {
+            const ProfileStats profile = emu.getProfileStats();
+            if (!profile.enabled) {
+                std::cerr << "Profiling is not compiled in (configure with -DGAMEBOY_PROFILE=ON)" << std::endl;
+            }
+            profile.writeJSON(std::cerr);
+            std::cerr << std::endl;
+        }
+        if (!saveStatePath.empty() && !emu.saveStateFile(saveStatePath)) {
+            return 1;
+        }
+        // テスト用: 期待した条件（合格のシリアル出力/基準画面）で止まったか
+        if (!expectedReason.empty() && result.exitReason != expectedReason) {
+            std::cerr << "Expected exit reason " << expectedReason << ", got " << result.exitReason << std::endl;
+            return 1;
+        }
+        return 0;
+    }
 
-    emu.runWithDisplay();                    // SDL2ウィンドウ付きメインループ開始
+#ifdef GAMEBOY_HAS_SDL
+    SDLFrontend frontend(emu, frontendOptions);
+    frontend.run();                          // SDL2ウィンドウ付きメインループ開始
+    saveTimeline();
+#endif
     return 0;
 }
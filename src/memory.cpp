@@ -1,5 +1,11 @@
 #include "memory.hpp"
 #include "input.hpp"
+#include "profiler.hpp"
+#include "savestate.hpp"
+#include "scheduler.hpp"
+#include "serial.hpp"
+#include "timeline.hpp"
+#include "timer.hpp"
 #include <fstream>
 #include <iostream>
 #include <iterator>
@@ -14,17 +20,29 @@ Memory::Memory()
 { // 64KBをゼロ初期化
 }
 
-void Memory::loadROM(const std::string& path) { // メモリにROMを読み込む
+bool Memory::loadROM(const std::string& path) { // メモリにROMを読み込む
     std::ifstream file(path, std::ios::binary);
     if (!file) {
         std::cerr << "Failed to open ROM file: " << path << std::endl;
-        return;
+        return false;
     }
-    rom.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
-    if (rom.empty()) {
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (!loadROMData(data.data(), data.size())) {
         std::cerr << "ROM file is empty: " << path << std::endl;
-        return;
+        return false;
+    }
+
+    // 標準出力はヘッドレス/ファームのJSON用なので、ロードの報告は標準エラーへ
+    std::cerr << "ROM loaded: " << path << std::endl;
+    std::cerr << "Total ROM size: " << rom.size() << " bytes (" << romBankCount << " banks)" << std::endl;
+    return true;
+}
+
+bool Memory::loadROMData(const uint8_t* data, size_t size) { // メモリ上のROMイメージを読み込む
+    if (size == 0) {
+        return false;
     }
+    rom.assign(data, data + size);
 
     if (rom.size() % 0x4000 != 0) {
         size_t padded = ((rom.size() + 0x3FFF) / 0x4000) * 0x4000;
@@ -39,11 +57,29 @@ void Memory::loadROM(const std::string& path) { // メモリにROMを読み込
     romBankUpper = 0;
     mbc1Mode = 0;
 
-    std::cout << "ROM loaded: " << path << std::endl;
-    std::cout << "Total ROM size: " << rom.size() << " bytes (" << romBankCount << " banks)" << std::endl;
+    romHash = 0xcbf29ce484222325ULL;  // FNV-1a
+    for (uint8_t b : rom) {
+        romHash = (romHash ^ b) * 0x100000001b3ULL;
+    }
+    return true;
+}
+
+namespace {
+// PPU/Timer/DMAの状態が見える領域（VRAM, OAM, IOレジスタ）
+inline bool needsSync(uint16_t addr) {
+    return (addr >= 0x8000 && addr < 0xA000) || (addr >= 0xFE00 && addr < 0xFF80);
+}
+}
+
+uint8_t Memory::readByte(uint16_t addr) const {
+    GB_PROFILE_SCOPE(profiler, ProfileSection::Memory);
+    if (scheduler && needsSync(addr)) {
+        scheduler->sync();
+    }
+    return readByteNoSync(addr);
 }
 
-uint8_t Memory::readByte(uint16_t addr) const { // メモリからバイトを読み込む
+uint8_t Memory::readByteNoSync(uint16_t addr) const { // メモリからバイトを読み込む
     if (addr < 0x8000) {
         return readROM(addr);
     } else if (addr < 0xA000) {
@@ -101,6 +137,11 @@ uint8_t Memory::readByte(uint16_t addr) const { // メモリからバイトを
 }
 
 void Memory::writeByte(uint16_t addr, uint8_t val) {
+    GB_PROFILE_SCOPE(profiler, ProfileSection::Memory);
+    // DMA中は転送元の書き換えとの前後関係があるので全領域で同期
+    if (scheduler && (dmaActive || needsSync(addr))) {
+        scheduler->sync();
+    }
     if (addr < 0x2000) {
         // RAM有効化コマンド（未使用）
     } else if (addr < 0x4000) {
@@ -125,6 +166,7 @@ void Memory::writeByte(uint16_t addr, uint8_t val) {
     } else if (addr < 0xFEA0) {
         if (oamLocked) return;
         oam[addr - 0xFE00] = val;
+        oamDirtyMask |= 1ULL << ((addr - 0xFE00) >> 2);
     } else if (addr < 0xFF00) {
         // 未使用
     } else if (addr >= 0xFF00 && addr < 0xFF80) {
@@ -135,21 +177,23 @@ void Memory::writeByte(uint16_t addr, uint8_t val) {
                 }
                 break;
             case 0xFF01: // SB
-                std::cout << "\n\033[1;33;41m"   // 黄文字・赤背景
-                          << "[SERIAL] SB ← 0x" << std::hex << (int)val
-                          << " (" << std::dec << (char)val << ")\033[0m\n";
-                SB = val;
+                if (serial) serial->writeSB(val);
+                else SB = val;
+                break;
+            case 0xFF02: // SC（bit7+bit0で内部クロック転送開始）
+                if (serial) serial->writeSC(val);
+                else SC = val;
                 break;
-            case 0xFF02: // SC
-                std::cout << "\n\033[1;36;44m"   // 水色文字・青背景
-                          << "[SERIAL] SC ← 0x" << std::hex << (int)val
-                          << "\033[0m\n";
-                SC = val;
+            case 0xFF04:  // DIVへの書き込みは0にリセット
+                if (timer) timer->writeDIV();
+                else DIV = 0;
                 break;
-            case 0xFF04: DIV = 0; break;  // DIVへの書き込みは0にリセット
             case 0xFF05: TIMA = val; break;
             case 0xFF06: TMA = val; break;
-            case 0xFF07: TAC = val; break;
+            case 0xFF07:
+                if (timer) timer->writeTAC(val);
+                else TAC = val;
+                break;
             case 0xFF0F: if_reg = val; break;
             case 0xFF40: LCDC = val; break;
             case 0xFF41: STAT = val & 0xF8; break;  // 下位3bitは読み取り専用
@@ -164,6 +208,10 @@ void Memory::writeByte(uint16_t addr, uint8_t val) {
             case 0xFF4A: WY = val; break;
             case 0xFF4B: WX = val; break;
         }
+        // IOレジスタの変更でイベント期限が変わり得るので次の命令前に再計算
+        if (scheduler) {
+            scheduler->requestSync();
+        }
     } else if (addr < 0xFFFF) {
         hram[addr - 0xFF80] = val;
     } else if (addr == 0xFFFF) {
@@ -223,6 +271,10 @@ void Memory::startDMA(uint8_t sourcePage) {
     dmaSource = sourcePage << 8;  // ページ番号をアドレスに変換 (例: 0x20 → 0x2000)
     dmaCycles = 0;
     oamLocked = true;  // DMA中はOAMアクセス禁止
+    if (timeline && scheduler) {
+        timeline->guestSpan(TimelineRecorder::Track::DMA, "OAM DMA", scheduler->now(), 160,
+                            "source", dmaSource);
+    }
 }
 
 void Memory::stepDMA() {
@@ -231,8 +283,9 @@ void Memory::stepDMA() {
     // 160バイトを1サイクルずつ転送 (実際のGame Boyは160サイクル)
     if (dmaCycles < 160) {
         uint16_t sourceAddr = dmaSource + dmaCycles;
-        uint8_t data = readByte(sourceAddr);
+        uint8_t data = readByteNoSync(sourceAddr);
         oam[dmaCycles] = data;
+        oamDirtyMask |= 1ULL << (dmaCycles >> 2);
         dmaCycles++;
     } else {
         // DMA完了
@@ -245,3 +298,48 @@ void Memory::stepDMA() {
 void Memory::setInputReference(Input* inputPtr) {
     input = inputPtr;
 }
+
+void Memory::saveState(StateWriter& out) const {
+    out.writeTag("MEM ");
+    const uint8_t io[] = {
+        LY, if_reg, ie, SB, SC, DIV, TIMA, TMA, TAC, LCDC, STAT,
+        SCY, SCX, LYC, BGP, OBP0, OBP1, WY, WX, DMA
+    };
+    out.writeBytes(io, sizeof(io));
+    out.writeBool(vramLocked);
+    out.writeBool(oamLocked);
+    out.writeBool(dmaActive);
+    out.write16(dmaSource);
+    out.write8(dmaCycles);
+    out.write8(romBankLower);
+    out.write8(romBankUpper);
+    out.write8(mbc1Mode);
+    out.writeBytes(vram.data(), vram.size());
+    out.writeBytes(wram.data(), wram.size());
+    out.writeBytes(oam.data(), oam.size());
+    out.writeBytes(hram.data(), hram.size());
+}
+
+void Memory::loadState(StateReader& in) {
+    if (!in.expectTag("MEM ")) return;
+    uint8_t* io[] = {
+        &LY, &if_reg, &ie, &SB, &SC, &DIV, &TIMA, &TMA, &TAC, &LCDC, &STAT,
+        &SCY, &SCX, &LYC, &BGP, &OBP0, &OBP1, &WY, &WX, &DMA
+    };
+    for (uint8_t* reg : io) {
+        *reg = in.read8();
+    }
+    vramLocked = in.readBool();
+    oamLocked = in.readBool();
+    dmaActive = in.readBool();
+    dmaSource = in.read16();
+    dmaCycles = in.read8();
+    romBankLower = in.read8();
+    romBankUpper = in.read8();
+    mbc1Mode = in.read8();
+    in.readBytes(vram.data(), vram.size());
+    in.readBytes(wram.data(), wram.size());
+    in.readBytes(oam.data(), oam.size());
+    in.readBytes(hram.data(), hram.size());
+    oamDirtyMask = 0xFFFFFFFFFFULL;  // スプライト索引は作り直させる
+}
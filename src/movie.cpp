@@ -0,0 +1,123 @@
+#include "movie.hpp"
+#include "emulator.hpp"
+#include "savestate.hpp"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace {
+constexpr uint32_t MOVIE_MAGIC = 0x564D4247;   // "GBMV"
+constexpr uint16_t MOVIE_VERSION = 2;   // 2: 状態ハッシュから画面を除いた
+}
+
+bool Movie::save(const std::string& path) const {
+    std::vector<uint8_t> data;
+    StateWriter out(data);
+    out.write32(MOVIE_MAGIC);
+    out.write16(MOVIE_VERSION);
+    out.write64(romHash);
+    out.write32(static_cast<uint32_t>(startState.size()));
+    out.writeBytes(startState.data(), startState.size());
+    out.write32(static_cast<uint32_t>(inputs.size()));
+    for (const MovieInput& in : inputs) {
+        out.write64(in.cycle);
+        out.write8(in.buttons);
+    }
+    out.write32(static_cast<uint32_t>(checkpoints.size()));
+    for (const MovieCheckpoint& cp : checkpoints) {
+        out.write64(cp.cycle);
+        out.write64(cp.stateHash);
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.write(reinterpret_cast<const char*>(data.data()), data.size())) {
+        std::cerr << "[MOVIE] Failed to write movie: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Movie::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "[MOVIE] Failed to open movie: " << path << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    StateReader in(data.data(), data.size());
+    if (in.read32() != MOVIE_MAGIC || in.read16() != MOVIE_VERSION) {
+        std::cerr << "[MOVIE] Unsupported movie format: " << path << std::endl;
+        return false;
+    }
+    romHash = in.read64();
+    startState.resize(in.read32());
+    in.readBytes(startState.data(), startState.size());
+
+    // 件数が壊れていても巨大な確保をしないよう、読めた分だけ積む
+    uint32_t inputCount = in.read32();
+    inputs.clear();
+    for (uint32_t i = 0; i < inputCount && in.ok(); ++i) {
+        MovieInput input;
+        input.cycle = in.read64();
+        input.buttons = in.read8();
+        inputs.push_back(input);
+    }
+    uint32_t checkpointCount = in.read32();
+    checkpoints.clear();
+    for (uint32_t i = 0; i < checkpointCount && in.ok(); ++i) {
+        MovieCheckpoint cp;
+        cp.cycle = in.read64();
+        cp.stateHash = in.read64();
+        checkpoints.push_back(cp);
+    }
+    if (!in.ok() || !in.atEnd()) {
+        std::cerr << "[MOVIE] Corrupt movie: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+MovieReplay replayMovie(Emulator& emu, const Movie& movie) {
+    MovieReplay replay;
+    const auto wallStart = std::chrono::steady_clock::now();
+
+    if (!emu.loadState(movie.startState.data(), movie.startState.size())) {
+        return replay;
+    }
+    replay.started = true;
+    const uint64_t startCycle = emu.getCycleCount();
+
+    // 入力とチェックポイントを時刻順にたどる。同じ時刻なら入力を先に反映する
+    size_t nextInput = 0;
+    size_t nextCheckpoint = 0;
+    while (nextInput < movie.inputs.size() || nextCheckpoint < movie.checkpoints.size()) {
+        bool inputFirst = nextCheckpoint >= movie.checkpoints.size() ||
+                          (nextInput < movie.inputs.size() &&
+                           movie.inputs[nextInput].cycle <= movie.checkpoints[nextCheckpoint].cycle);
+        uint64_t target = inputFirst ? movie.inputs[nextInput].cycle : movie.checkpoints[nextCheckpoint].cycle;
+
+        // 記録時と同じ命令境界で止まる（記録された時刻はその区間で最初に期限を越えた境界）
+        if (target > emu.getCycleCount()) {
+            RunOptions segment;
+            segment.maxCycles = target - emu.getCycleCount();
+            emu.run(segment);
+        }
+
+        if (inputFirst) {
+            emu.setButtonMask(movie.inputs[nextInput++].buttons);
+        } else {
+            if (emu.getStateHash() != movie.checkpoints[nextCheckpoint].stateHash ||
+                emu.getCycleCount() != movie.checkpoints[nextCheckpoint].cycle) {
+                replay.desyncCheckpoint = static_cast<int64_t>(nextCheckpoint);
+                break;
+            }
+            ++nextCheckpoint;
+            ++replay.checkpointsVerified;
+        }
+    }
+
+    replay.cycles = emu.getCycleCount() - startCycle;
+    replay.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    return replay;
+}
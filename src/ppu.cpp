@@ -1,9 +1,10 @@
 #include "ppu.hpp"
 #include "memory.hpp"
+#include "savestate.hpp"
+#include "timeline.hpp"
 #include <algorithm>
 #include <fstream>
 #include <iostream>
-#include <iomanip>
 
 // Game Boy仕様
 // CPU::step()は1dot（Tサイクル）単位。1ライン=456dot
@@ -32,17 +33,24 @@ void PPU::reset() {
     scxDiscard            = 0;
     fetcherState          = 0;
     fetcherDotCounter     = 0;
+    cachedWX              = memory.WX;
     mode                  = 2;
     memory.LY             = 0;
-    for (int y = 0; y < 144; ++y) {
-        for (int x = 0; x < 160; ++x) {
-            framebuffer[y * 160 + x] = 0x00000000;  // 灰色で塗りつぶす例
-        }
-}
-
+    frameCounter          = 0;
+    renderThisFrame       = (renderMode != RenderMode::TimingOnly);
+    std::fill(std::begin(framebuffer), std::end(framebuffer), 0);  // シェード0（白）で埋める
+    const uint64_t blankHash = hashFrameLine(framebuffer);
+    std::fill(std::begin(lineHashes), std::end(lineHashes), blankHash);
+    dirtyLines.reset();
+    frameDirtyLines.reset();
+    frameHash = combineLineHashes(lineHashes);
+    completedFrames = 0;
+    indexHeight = 0;  // スプライト索引は次回使用時に作り直す
 }
 
 void PPU::step(int cycles) {
+    const uint64_t stepEnd = clock + cycles;  // ライン末の時刻は stepEnd - 残りサイクル
+    clock = stepEnd;
     if ((memory.LCDC & 0x80) == 0) {
         mode = 0;
         dotCounter = 0;
@@ -63,7 +71,25 @@ void PPU::step(int cycles) {
         return;
     }
 
-    for (int i = 0; i < cycles; ++i) {
+    bool firstDot = true;
+    while (cycles > 0) {
+        // 何も起きないドットはまとめて飛ばす（呼び出し最初のドットは必ず通常処理して
+        // CPUが書き換えたLYC/STATを反映する）
+        if (!firstDot) {
+            int quiet = quietDotsAhead();
+            if (quiet > 0) {
+                int run = std::min(quiet, cycles);
+                dotCounter += run;
+                cycles -= run;
+                if (dotCounter == SCANLINE_CYCLES) {
+                    if (timeline) recordLine(stepEnd - cycles);
+                    endLine();
+                }
+                continue;
+            }
+        }
+        firstDot = false;
+
         // 可視ライン中（LY=0..143）
         updateCoincidence(); // LYC=LY割り込みチェック
         if (currentLine < VBLANK_START) {
@@ -79,7 +105,8 @@ void PPU::step(int cycles) {
                 default: break;
             }
 
-            if (dotCounter >= MODE3_START && dotCounter < MODE0_START) {
+            // 描画しないフレームではフェッチャー処理ごと省略（モード遷移は上で済んでいる）
+            if (renderThisFrame && dotCounter >= MODE3_START && dotCounter < MODE0_START) {
                 stepMode3(dotCounter);
             }
         }
@@ -93,40 +120,116 @@ void PPU::step(int cycles) {
 
         // ── ドット進行 ──
         ++dotCounter;
+        --cycles;
 
         // ── 行末処理 ──
         if (dotCounter == SCANLINE_CYCLES) { // 456dot ちょうどで行送り
-            dotCounter = 0;
+            if (timeline) recordLine(stepEnd - cycles);
+            endLine();
+        }
+    }
+}
 
-            // Window行カウンタの更新（その行で一度でもWindow描画したら）
-            if (currentLine < VBLANK_START && windowEnabledThisLine && windowLineStarted) {
-                ++windowLineCounter;
-            }
-            windowLineStarted = false;
-            windowActive = false;
-
-            // 次の行へ
-            currentLine++;
-
-            // LY/STAT更新
-            memory.LY = currentLine;
-
-            // VBlank開始/フレーム終了
-            if (currentLine == VBLANK_START) {
-                enterVBlank();   // 念のため境界でも一度だけ
-            } else if (currentLine >= TOTAL_LINES) {
-                currentLine = 0;
-                memory.LY = 0;
-                windowLineCounter = 0;
-                // 次行の dot=0 ケースで enterMode2() が呼ばれる
-            }
+void PPU::endLine() {
+    dotCounter = 0;
+
+    // Window行カウンタの更新（その行で一度でもWindow描画したら）
+    if (currentLine < VBLANK_START && windowEnabledThisLine && windowLineStarted) {
+        ++windowLineCounter;
+    }
+    windowLineStarted = false;
+    windowActive = false;
+
+    // 次の行へ
+    currentLine++;
+
+    // LY/STAT更新
+    memory.LY = currentLine;
+
+    // VBlank開始/フレーム終了
+    if (currentLine == VBLANK_START) {
+        enterVBlank();   // 念のため境界でも一度だけ
+    } else if (currentLine >= TOTAL_LINES) {
+        currentLine = 0;
+        memory.LY = 0;
+        windowLineCounter = 0;
+        beginFrame();
+        // 次行の dot=0 ケースで enterMode2() が呼ばれる
+    }
+}
+
+void PPU::recordLine(uint64_t lineEnd) const {
+    // モード遷移の位置は固定（Mode3の長さは172dot）なので、ライン末でまとめて記録する
+    using Track = TimelineRecorder::Track;
+    const uint64_t lineStart = lineEnd - SCANLINE_CYCLES;
+    if (currentLine < VBLANK_START) {
+        timeline->guestSpan(Track::PPU, "OAM scan", lineStart, MODE2_LENGTH);
+        timeline->guestSpan(Track::PPU, "pixel transfer", lineStart + MODE3_START, MODE0_START - MODE3_START);
+        timeline->guestSpan(Track::PPU, "HBlank", lineStart + MODE0_START, SCANLINE_CYCLES - MODE0_START);
+    }
+    timeline->guestSpan(Track::PPU, "line", lineStart, SCANLINE_CYCLES, "ly", currentLine);
+    if (currentLine == TOTAL_LINES - 1) {
+        const uint64_t vblankCycles = uint64_t(TOTAL_LINES - VBLANK_START) * SCANLINE_CYCLES;
+        timeline->guestSpan(Track::PPU, "VBlank", lineEnd - vblankCycles, vblankCycles);
+        timeline->guestSpan(Track::PPU, "frame", lineEnd - uint64_t(TOTAL_LINES) * SCANLINE_CYCLES,
+                            uint64_t(TOTAL_LINES) * SCANLINE_CYCLES, "frame", static_cast<int64_t>(completedFrames));
+    }
+}
+
+int PPU::quietDotsAhead() const {
+    // updateCoincidence()以外に何もしないドットが dotCounter から何個続くか
+    const int d = dotCounter;
+    if (d == 0) return 0;                       // 行頭はLY変化の反映が必要
+    if (currentLine < VBLANK_START) {
+        if (d < MODE3_START) return MODE3_START - d;
+        if (d < MODE0_START) {
+            if (renderThisFrame || d == MODE3_START) return 0;
+            return MODE0_START - d;             // 描画しないフレームのMode3
         }
+        if (d == MODE0_START) return 0;
     }
+    return SCANLINE_CYCLES - d;
+}
 
+int PPU::cyclesUntilEvent() const {
+    // CPUから見える変化（STAT/LY/割り込み）が次に起きるまでのサイクル数
+    if ((memory.LCDC & 0x80) == 0) return -1;   // LCDオフ中はLCDC書き込みまで何も起きない
 
-    return;
+    const int d = dotCounter;
+    if (d == 0) return 1;
+    if (currentLine < VBLANK_START) {
+        if (d == MODE3_START || d == MODE0_START) return 1;
+        if (d < MODE3_START) return MODE3_START - d + 1;
+        if (d < MODE0_START) return MODE0_START - d + 1;
+    }
+    return SCANLINE_CYCLES - d + 1;             // 行送り＋次行の dot=0 まで
+}
+
+
+void PPU::setRenderMode(RenderMode mode, int interval) {
+    renderMode = mode;
+    renderInterval = (interval < 1) ? 1 : interval;
+    // 次フレームの頭から反映（描画途中のフレームは崩さない）
+    // ただしフレーム開始前（リセット直後など）なら即時反映
+    if (currentLine == 0 && dotCounter == 0) {
+        renderThisFrame = (renderMode != RenderMode::TimingOnly);
+    }
 }
 
+void PPU::beginFrame() {
+    ++frameCounter;
+    switch (renderMode) {
+        case RenderMode::Full:
+            renderThisFrame = true;
+            break;
+        case RenderMode::EveryNth:
+            renderThisFrame = (frameCounter % renderInterval) == 0;
+            break;
+        case RenderMode::TimingOnly:
+            renderThisFrame = false;
+            break;
+    }
+}
 
 void PPU::setMode(uint8_t newMode) {
     newMode &= 0x03;
@@ -203,15 +306,17 @@ void PPU::enterMode2() { //OAM find
         }
     }
 
+    // スプライトはMode3直前にまとめて選ぶ（enterMode3）
     spriteCount = 0;
-    gatherSprites();
 
 }
 
 void PPU::enterMode3() {
     setMode(3);  // setMode()を使ってSTAT割り込み処理
     // VRAMもロックして描画開始
-    gatherSprites(); //Mode3の直前にも飛ぶ＝タイミング補正
+    if (renderThisFrame) {
+        gatherSprites(); //Mode3の直前に選ぶ＝タイミング補正
+    }
     memory.oamLocked = true;
     memory.vramLocked = true;
     fetcherDotCounter = 0;  // Mode3開始時にフェッチャーカウンタリセット
@@ -219,6 +324,9 @@ void PPU::enterMode3() {
 
 void PPU::enterMode0() {
     setMode(0);  // setMode()を使ってSTAT割り込み処理
+    if (renderThisFrame) {
+        finishLine();  // このラインのピクセルは出揃った
+    }
     // ロック解除
     memory.oamLocked = false;
     memory.vramLocked = false;
@@ -230,6 +338,30 @@ void PPU::enterVBlank() {
     memory.oamLocked = false;
     memory.vramLocked = false;
     memory.if_reg |= 0x01; // VBlank割り込み要求
+    if (renderThisFrame) {
+        finishFrame();
+    }
+}
+
+void PPU::finishLine() {
+    const uint8_t* line = &framebuffer[currentLine * FRAME_LINE_BYTES];
+    uint64_t h = hashFrameLine(line);
+    dirtyLines[currentLine] = (h != lineHashes[currentLine]);
+    lineHashes[currentLine] = h;
+    if (frameTarget.pixels && (!frameTarget.lineHashes || frameTarget.lineHashes[currentLine] != h)) {
+        convertFrameLine(line, static_cast<uint8_t*>(frameTarget.pixels) + currentLine * frameTarget.pitch,
+                         frameTarget.format);
+        if (frameTarget.lineHashes) {
+            frameTarget.lineHashes[currentLine] = h;
+        }
+    }
+}
+
+void PPU::finishFrame() {
+    frameHash = combineLineHashes(lineHashes);
+    frameDirtyLines = dirtyLines;
+    dirtyLines.reset();
+    ++completedFrames;
 }
 
 
@@ -241,7 +373,6 @@ void PPU::stepMode3(int dotCounter) {
   int screenX = dotCounter - MODE3_START -8 ;
 
   // リアルタイムWXチェック: WXが変更されたらwindowEnabledThisLineを再計算
-  static uint8_t cachedWX = memory.WX;
   if (memory.WX != cachedWX) {
     cachedWX = memory.WX;
 
@@ -292,7 +423,7 @@ void PPU::stepMode3(int dotCounter) {
 
         uint16_t tileMapAddr = tileMapBase + tileRow * 32 + tileCol;
 
-        fetchTileNumber = readPPUByte(tileMapAddr);
+        fetchTileNumber = memory.readVRAM(tileMapAddr);
         fetcherState = 1; // ウェイト1
         break;
       }
@@ -313,7 +444,7 @@ void PPU::stepMode3(int dotCounter) {
             : static_cast<uint8_t>(bgLineY & 0x07);
 
         fetchTileAddr = static_cast<uint16_t>(tileAddrBase + tileIndex * 16 + lineInTile * 2);
-        fetchDataLow = readPPUByte(fetchTileAddr);
+        fetchDataLow = memory.readVRAM(fetchTileAddr);
         fetcherState = 3; // ウェイト
         break;
       }
@@ -322,7 +453,7 @@ void PPU::stepMode3(int dotCounter) {
         break;
 
       case 4: // タイルラインHigh取得
-        fetchDataHigh = readPPUByte(fetchTileAddr + 1);
+        fetchDataHigh = memory.readVRAM(fetchTileAddr + 1);
         fetcherState = 5; // ウェイト
         break;
 
@@ -365,51 +496,20 @@ void PPU::stepMode3(int dotCounter) {
     return;
   }
 
-  // BGの2bit色 → DMGパレット(BGP)で 4階調ARGBへ
+  // BGの2bit色 → DMGパレット(BGP)で 4階調のシェード番号へ（ARGB化は表示側で行う）
   uint8_t bgColorId = bgFifo.front();
   bgFifo.pop_front();
 
-  uint32_t pixel = decodeDMGColor(memory.BGP, bgColorId);
+  uint8_t pixel = decodeDMGShade(memory.BGP, bgColorId);
   uint8_t finalColor = bgColorId;
   bool bgOpaque = (bgColorId != 0);
 
   // スプライト処理 (リアルタイムパレット対応)
   int spriteScreenX = screenX + 2;  // スプライト用座標をscreenXと同じにする
 
-  // スプライトパレット変更検出
-  static uint8_t cachedOBP0 = memory.OBP0;
-  static uint8_t cachedOBP1 = memory.OBP1;
-
-  if (memory.OBP0 != cachedOBP0 || memory.OBP1 != cachedOBP1) {
-    cachedOBP0 = memory.OBP0;
-    cachedOBP1 = memory.OBP1;
-  }
-
   for (int s = 0; s < spriteCount; ++s) {
     const SpriteLine& spr = spriteLineBuffer[s];
 
-    // line 51-54 (0x33-0x36) のスプライトデバッグ
-    if ((currentLine >= 0x33 && currentLine <= 0x36) && screenX >= 0 && screenX < 160) {
-      // 最初のspriteだけ、または重要な位置でのみ詳細表示
-      if (s == 0 || (spriteScreenX >= spr.x && spriteScreenX < spr.x + 8)) {
-        std::cout << "LINE" << std::hex << (int)currentLine << std::dec
-                  << "[" << std::setw(3) << screenX << "] "
-                  << "SPR[" << s << "] "
-                  << "sprX=" << std::setw(3) << spr.x
-                  << " scrX=" << std::setw(3) << spriteScreenX
-                  << " tile=" << std::hex << (int)spr.tile << std::dec
-                  << " attr=" << std::hex << (int)spr.attr << std::dec
-                  << " prio=" << spr.priority;
-
-        if (spriteScreenX >= spr.x && spriteScreenX < spr.x + 8) {
-          int pixelIndex = spriteScreenX - spr.x;
-          uint8_t spriteColor = spr.pixels[pixelIndex];
-          std::cout << " px[" << pixelIndex << "]=" << (int)spriteColor;
-        }
-        std::cout << " sprCnt=" << spriteCount << std::endl;
-      }
-    }
-
     // X座標範囲チェック
     if (spriteScreenX < spr.x || spriteScreenX >= spr.x + 8) {
       continue;
@@ -428,36 +528,32 @@ void PPU::stepMode3(int dotCounter) {
 
     // リアルタイムパレット使用 (gatherSprites時のパレットではなく現在のパレット)
     uint8_t currentPalette = (spr.attr & 0x10) ? memory.OBP1 : memory.OBP0;
-    pixel = decodeDMGColor(currentPalette, spriteColor);
+    pixel = decodeDMGShade(currentPalette, spriteColor);
     finalColor = spriteColor;
     bgOpaque = true;
     break;  // 最初に見つかったスプライトを採用（優先度順）
   }
 
-  framebuffer[currentLine * 160 + screenX] = pixel;
+  setShade(framebuffer, screenX, currentLine, pixel);
 
 
 
 }
 
 
-uint8_t PPU::readPPUByte(uint16_t addr) {
-    bool vramPrev = memory.vramLocked;
-    bool oamPrev  = memory.oamLocked;
-    memory.vramLocked = false;   // PPU内部読み込みなので一時的にロック解除
-    memory.oamLocked  = false;
-    uint8_t v = memory.readByte(addr);
-    memory.vramLocked = vramPrev;
-    memory.oamLocked  = oamPrev;
-    return v;
+uint8_t PPU::decodeDMGShade(uint8_t palette, uint8_t colorId) const {
+    return (palette >> (colorId * 2)) & 0x03;
 }
 
-uint32_t PPU::decodeDMGColor(uint8_t palette, uint8_t colorId) const {
-    static constexpr uint32_t COLORS[4] = {
-        0xFFFFFFFF, 0xFFBFBFBF, 0xFF7F7F7F, 0xFF1F1F1F
-    };
-    uint8_t shade = (palette >> (colorId * 2)) & 0x03;
-    return COLORS[shade];
+void PPU::setFrameTarget(const FrameTarget& target) {
+    frameTarget = target;
+    if (frameTarget.pitch <= 0) {
+        frameTarget.pitch = SCREEN_WIDTH * bytesPerPixel(frameTarget.format);
+    }
+}
+
+void PPU::convertFrame(void* dst, int pitch, PixelFormat fmt) const {
+    ::convertFrame(framebuffer, dst, pitch, fmt);
 }
 
 void PPU::saveFramePPM(const std::string& path) const {
@@ -468,16 +564,13 @@ void PPU::saveFramePPM(const std::string& path) const {
     }
 
     out << "P6\n160 144\n255\n";
-    for (int y = 0; y < 144; ++y) {
-        const uint32_t* line = &framebuffer[y * 160];
-        for (int x = 0; x < 160; ++x) {
-            uint32_t pixel = line[x];
-            uint8_t r = (pixel >> 16) & 0xFF;
-            uint8_t g = (pixel >> 8) & 0xFF;
-            uint8_t b = pixel & 0xFF;
-            out.put(static_cast<char>(r));
-            out.put(static_cast<char>(g));
-            out.put(static_cast<char>(b));
+    uint8_t gray[SCREEN_WIDTH];
+    for (int y = 0; y < SCREEN_HEIGHT; ++y) {
+        convertFrameLine(&framebuffer[y * FRAME_LINE_BYTES], gray, PixelFormat::Gray8);
+        for (int x = 0; x < SCREEN_WIDTH; ++x) {
+            out.put(static_cast<char>(gray[x]));
+            out.put(static_cast<char>(gray[x]));
+            out.put(static_cast<char>(gray[x]));
         }
     }
 }
@@ -485,97 +578,272 @@ void PPU::saveFramePPM(const std::string& path) const {
 
 void PPU::gatherSprites() {
     // スプライト無効なら何もしない
-    if ((memory.LCDC & 0x02) == 0) {
+    if ((memory.LCDC & 0x02) == 0 || currentLine >= VBLANK_START) {
         spriteCount = 0;
         return;
     }
 
     int spriteHeight = (memory.LCDC & 0x04) ? 16 : 8;  // 8x8 or 8x16
-    spriteCount = 0;
+    updateSpriteIndex(spriteHeight);
+    if (!lineSpritesValid[currentLine]) {
+        buildLineSprites(currentLine);
+    }
+
+    const uint8_t* oam = memory.getOAM();
+    spriteCount = lineSpriteCount[currentLine];
 
-    // OAMから40個のスプライトをチェック（最大10個まで）
-    for (int i = 0; i < 40 && spriteCount < 10; ++i) {
-        uint16_t oamAddr = 0xFE00 + i * 4;
-        uint8_t y = readPPUByte(oamAddr);
-        uint8_t x = readPPUByte(oamAddr + 1);
-        uint8_t tile = readPPUByte(oamAddr + 2);
-        uint8_t attr = readPPUByte(oamAddr + 3);
+    // 索引で選ばれた（最大10個・X順済みの）スプライトだけタイルを読む
+    for (int s = 0; s < spriteCount; ++s) {
+        const uint8_t* entry = &oam[lineSprites[currentLine][s] * 4];
+        uint8_t y = entry[0];
+        uint8_t x = entry[1];
+        uint8_t tile = entry[2];
+        uint8_t attr = entry[3];
 
         // スプライト位置調整（GBはY-16, X-8）
         int spriteY = static_cast<int>(y) - 16;
         int spriteX = static_cast<int>(x) - 8;
 
-        // 現在ラインと重なるかチェック
-        if (spriteY <= static_cast<int>(currentLine) &&
-            static_cast<int>(currentLine) < spriteY + spriteHeight) {
+        SpriteLine& info = spriteLineBuffer[s];
+        info.x = spriteX;
+        info.priority = (attr & 0x80) != 0;  // OBJ-to-BG Priority
+        info.palette = (attr & 0x10) ? memory.OBP1 : memory.OBP0;
+        info.attr = attr;
+        info.tile = tile;
 
-            SpriteLine& info = spriteLineBuffer[spriteCount++];
-            info.x = spriteX;
-            info.priority = (attr & 0x80) != 0;  // OBJ-to-BG Priority
-            info.palette = (attr & 0x10) ? memory.OBP1 : memory.OBP0;
-            info.attr = attr;
-            info.tile = tile;
+        // スプライト内での行位置計算
+        int lineInSprite = static_cast<int>(currentLine) - spriteY;
 
-            // スプライト内での行位置計算
-            int lineInSprite = static_cast<int>(currentLine) - spriteY;
+        // Y-flip処理
+        if (attr & 0x40) {
+            lineInSprite = spriteHeight - 1 - lineInSprite;
+        }
 
-            // Y-flip処理
-            if (attr & 0x40) {
-                lineInSprite = spriteHeight - 1 - lineInSprite;
-            }
+        // 8x16モードでは下位1bitを0にする
+        if (spriteHeight == 16) {
+            tile &= 0xFE;
+        }
 
-            // 8x16モードでは下位1bitを0にする
-            if (spriteHeight == 16) {
-                tile &= 0xFE;
-            }
+        // タイルデータ読み込み（スプライトは常に0x8000-0x8FFF）
+        uint16_t tileAddr = 0x8000 + tile * 16 + lineInSprite * 2;
+        uint8_t low = memory.readVRAM(tileAddr);
+        uint8_t high = memory.readVRAM(tileAddr + 1);
+
+        // 8ピクセル分のデータを準備
+        for (int px = 0; px < 8; ++px) {
+            int bit = (attr & 0x20) ? px : (7 - px);  // X-flip処理
+            info.pixels[px] = static_cast<uint8_t>(
+                ((high >> bit) & 0x01) << 1 | ((low >> bit) & 0x01)
+            );
+        }
+    }
+}
 
-            // タイルデータ読み込み（スプライトは常に0x8000-0x8FFF）
-            uint16_t tileAddr = 0x8000 + tile * 16 + lineInSprite * 2;
-            uint8_t low = readPPUByte(tileAddr);
-            uint8_t high = readPPUByte(tileAddr + 1);
-
-            // LINE 0x58と0x59でタイルデータを確認
-            if (currentLine == 0x58 || currentLine == 0x59) {
-                if (tile == 0x0C || tile == 0x0D) {
-                    std::cout << "[TILE] LINE" << std::hex << (int)currentLine
-                              << " dot=" << std::dec << dotCounter
-                              << " sprY=" << spriteY
-                              << " tile=" << std::hex << (int)tile
-                              << " addr=" << tileAddr
-                              << " low=" << (int)low << " high=" << (int)high
-                              << " lineInSpr=" << std::dec << lineInSprite
-                              << " height=" << spriteHeight
-                              << " (gathered at Mode2)" << std::endl;
-                }
-            }
+void PPU::updateSpriteIndex(int spriteHeight) {
+    // スプライト高さが変わったら全体を作り直す
+    if (spriteHeight != indexHeight) {
+        std::fill(std::begin(lineSpriteMask), std::end(lineSpriteMask), 0);
+        std::fill(std::begin(spriteLineCount), std::end(spriteLineCount), 0);
+        for (int i = 0; i < 40; ++i) {
+            addSpriteToIndex(i, spriteHeight);
+        }
+        indexHeight = spriteHeight;
+        memory.oamDirtyMask = 0;
+        lineSpritesValid.reset();
+        return;
+    }
 
-            // 8ピクセル分のデータを準備
-            for (int px = 0; px < 8; ++px) {
-                int bit = (attr & 0x20) ? px : (7 - px);  // X-flip処理
-                info.pixels[px] = static_cast<uint8_t>(
-                    ((high >> bit) & 0x01) << 1 | ((low >> bit) & 0x01)
-                );
-            }
+    // 書き換えられたスプライトだけ掛け直す
+    uint64_t dirty = memory.oamDirtyMask;
+    if (dirty == 0) return;
+    memory.oamDirtyMask = 0;
+    for (int i = 0; i < 40; ++i) {
+        if (dirty & (1ULL << i)) {
+            removeSpriteFromIndex(i);
+            addSpriteToIndex(i, spriteHeight);
         }
     }
+}
+
+void PPU::removeSpriteFromIndex(int index) {
+    const uint64_t bit = 1ULL << index;
+    const int first = spriteFirstLine[index];
+    for (int line = first; line < first + spriteLineCount[index]; ++line) {
+        lineSpriteMask[line] &= ~bit;
+        lineSpritesValid[line] = false;
+    }
+    spriteLineCount[index] = 0;
+}
+
+void PPU::addSpriteToIndex(int index, int spriteHeight) {
+    int spriteY = static_cast<int>(memory.getOAM()[index * 4]) - 16;
+    int first = std::max(spriteY, 0);
+    int last  = std::min(spriteY + spriteHeight - 1, VBLANK_START - 1);
+    if (first > last) {
+        spriteLineCount[index] = 0;
+        return;
+    }
+
+    const uint64_t bit = 1ULL << index;
+    for (int line = first; line <= last; ++line) {
+        lineSpriteMask[line] |= bit;
+        lineSpritesValid[line] = false;  // X等の変更もここで無効化される
+    }
+    spriteFirstLine[index] = static_cast<uint8_t>(first);
+    spriteLineCount[index] = static_cast<uint8_t>(last - first + 1);
+}
+
+void PPU::buildLineSprites(int line) {
+    const uint8_t* oam = memory.getOAM();
+    const uint64_t mask = lineSpriteMask[line];
+    uint8_t* ids = lineSprites[line];
+    int count = 0;
 
-    // スプライト優先度ソート（X座標優先、同じ場合はOAMインデックス優先）
-    std::sort(spriteLineBuffer, spriteLineBuffer + spriteCount,
-              [](const SpriteLine& a, const SpriteLine& b) {
-                  if (a.x != b.x) return a.x < b.x;  // X座標で優先
-                  // X座標が同じ場合はOAMインデックス（収集順）で優先
-                  return false;  // 安定ソートで元の順序を保持
-              });
-
-    // LINE 51-54 (0x33-0x36) でのsprite収集結果を確認
-    if (currentLine >= 0x33 && currentLine <= 0x36) {
-        std::cout << "[GATHER] LINE " << std::hex << (int)currentLine << std::dec
-                  << " found " << spriteCount << " sprites (sorted by X):";
-        for (int i = 0; i < spriteCount; ++i) {
-            std::cout << " [" << i << "]x=" << spriteLineBuffer[i].x
-                      << "/tile=" << std::hex << (int)spriteLineBuffer[i].tile << std::dec
-                      << "/prio=" << spriteLineBuffer[i].priority;
+    // OAM順に最大10個
+    for (int i = 0; i < 40 && count < 10; ++i) {
+        if (mask & (1ULL << i)) {
+            ids[count++] = static_cast<uint8_t>(i);
         }
-        std::cout << std::endl;
     }
+
+    // スプライト優先度ソート（X座標優先、同じ場合はOAMインデックス優先＝安定挿入ソート）
+    for (int i = 1; i < count; ++i) {
+        uint8_t id = ids[i];
+        int j = i - 1;
+        while (j >= 0 && oam[ids[j] * 4 + 1] > oam[id * 4 + 1]) {
+            ids[j + 1] = ids[j];
+            --j;
+        }
+        ids[j + 1] = id;
+    }
+
+    lineSpriteCount[line] = static_cast<uint8_t>(count);
+    lineSpritesValid[line] = true;
+}
+
+void PPU::saveState(StateWriter& out) const {
+    out.writeTag("PPU ");
+    out.write8(currentLine);
+    out.write8(mode);
+    out.writeBool(coincidence);
+    out.write32(static_cast<uint32_t>(dotCounter));
+    out.writeBytes(framebuffer, sizeof(framebuffer));
+
+    out.write64(frameCounter);
+    out.writeBool(renderThisFrame);
+    for (uint64_t h : lineHashes) {
+        out.write64(h);
+    }
+    for (int y = 0; y < SCREEN_HEIGHT; ++y) {
+        out.write8(static_cast<uint8_t>(dirtyLines[y] | (frameDirtyLines[y] << 1)));
+    }
+    out.write64(frameHash);
+    out.write64(completedFrames);
+
+    // ピクセルフェッチャー/FIFO/ウィンドウ
+    out.write8(static_cast<uint8_t>(bgFifo.size()));
+    for (uint8_t px : bgFifo) {
+        out.write8(px);
+    }
+    out.write8(fetchTileNumber);
+    out.write8(fetchDataLow);
+    out.write8(fetchDataHigh);
+    out.write8(fetcherX);
+    out.write16(fetchTileAddr);
+    out.writeBool(fetchUsingWindow);
+    out.write32(static_cast<uint32_t>(fetcherState));
+    out.write8(bgLineY);
+    out.write8(windowLineCounter);
+    out.writeBool(windowLineStarted);
+    out.writeBool(windowActive);
+    out.writeBool(windowEnabledThisLine);
+    out.write32(static_cast<uint32_t>(windowTriggerX));
+    out.write8(scxDiscard);
+    out.write32(static_cast<uint32_t>(fetcherDotCounter));
+    out.write8(cachedWX);
+
+    // このラインで選ばれたスプライト（索引はキャッシュなので保存しない）
+    out.write8(static_cast<uint8_t>(spriteCount));
+    for (int i = 0; i < spriteCount; ++i) {
+        const SpriteLine& s = spriteLineBuffer[i];
+        out.write32(static_cast<uint32_t>(s.x));
+        out.write8(s.palette);
+        out.writeBool(s.priority);
+        out.writeBytes(s.pixels, sizeof(s.pixels));
+        out.write8(s.attr);
+        out.write8(s.tile);
+    }
+}
+
+void PPU::saveTimingState(StateWriter& out) const {
+    out.writeTag("PPUT");
+    out.write8(currentLine);
+    out.write8(mode);
+    out.writeBool(coincidence);
+    out.write32(static_cast<uint32_t>(dotCounter));
+}
+
+void PPU::loadState(StateReader& in) {
+    if (!in.expectTag("PPU ")) return;
+    currentLine = in.read8();
+    mode = in.read8();
+    coincidence = in.readBool();
+    dotCounter = static_cast<int>(in.read32());
+    // 範囲外のままだと行末（dot 456）や行送りに届かず step() が抜け出せなくなる
+    if (!in.require(currentLine < TOTAL_LINES && mode <= 3 &&
+                    dotCounter >= 0 && dotCounter < SCANLINE_CYCLES)) {
+        return;
+    }
+    in.readBytes(framebuffer, sizeof(framebuffer));
+
+    frameCounter = in.read64();
+    renderThisFrame = in.readBool() && renderMode != RenderMode::TimingOnly;
+    for (uint64_t& h : lineHashes) {
+        h = in.read64();
+    }
+    for (int y = 0; y < SCREEN_HEIGHT; ++y) {
+        uint8_t bits = in.read8();
+        dirtyLines[y] = bits & 0x01;
+        frameDirtyLines[y] = (bits >> 1) & 0x01;
+    }
+    frameHash = in.read64();
+    completedFrames = in.read64();
+
+    bgFifo.clear();
+    uint8_t fifoSize = in.read8();
+    for (int i = 0; i < fifoSize; ++i) {
+        bgFifo.push_back(in.read8());
+    }
+    fetchTileNumber = in.read8();
+    fetchDataLow = in.read8();
+    fetchDataHigh = in.read8();
+    fetcherX = in.read8();
+    fetchTileAddr = in.read16();
+    fetchUsingWindow = in.readBool();
+    fetcherState = static_cast<int>(in.read32());
+    if (!in.require(fetcherState >= 0 && fetcherState <= 6)) {
+        return;
+    }
+    bgLineY = in.read8();
+    windowLineCounter = in.read8();
+    windowLineStarted = in.readBool();
+    windowActive = in.readBool();
+    windowEnabledThisLine = in.readBool();
+    windowTriggerX = static_cast<int>(in.read32());
+    scxDiscard = in.read8();
+    fetcherDotCounter = static_cast<int>(in.read32());
+    cachedWX = in.read8();
+
+    spriteCount = std::min<int>(in.read8(), 10);
+    for (int i = 0; i < spriteCount; ++i) {
+        SpriteLine& s = spriteLineBuffer[i];
+        s.x = static_cast<int>(in.read32());
+        s.palette = in.read8();
+        s.priority = in.readBool();
+        in.readBytes(s.pixels, sizeof(s.pixels));
+        s.attr = in.read8();
+        s.tile = in.read8();
+    }
+
+    indexHeight = 0;  // スプライト索引は次回使用時に作り直す
 }
@@ -0,0 +1,161 @@
+#include "profiler.hpp"
+#include <mutex>
+#if defined(__unix__) || defined(__APPLE__)
+#include <csignal>
+#include <ctime>
+#include <sys/time.h>
+#define GAMEBOY_PROFILE_SIGNALS 1
+#endif
+
+void profilerSampleHandler(int);
+
+namespace {
+const char* const SECTION_NAMES[ProfileStats::SECTION_COUNT] = {
+    "other", "cpu", "memory", "ppu_hblank", "ppu_vblank", "ppu_oam_scan", "ppu_transfer",
+    "timer", "dma", "events", "display",
+};
+
+thread_local Profiler* activeProfiler = nullptr;
+
+std::mutex installMutex;
+int instanceCount = 0;
+std::atomic<uint64_t> dumpRequests{0};
+
+// 呼び出したスレッドのCPU時間（シグナルハンドラからも呼べる）
+uint64_t threadCPUNanoseconds() {
+#ifdef GAMEBOY_PROFILE_SIGNALS
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+        return uint64_t(ts.tv_sec) * 1000000000ULL + uint64_t(ts.tv_nsec);
+    }
+#endif
+    return 0;
+}
+
+#ifdef GAMEBOY_PROFILE_SIGNALS
+struct sigaction previousProf;
+struct sigaction previousUsr1;
+
+void dumpRequestHandler(int) {
+    dumpRequests.fetch_add(1, std::memory_order_relaxed);
+}
+
+void installSignals() {
+    struct sigaction action = {};
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    action.sa_handler = profilerSampleHandler;
+    sigaction(SIGPROF, &action, &previousProf);
+    action.sa_handler = dumpRequestHandler;
+    sigaction(SIGUSR1, &action, &previousUsr1);
+
+    struct itimerval timer = {};
+    timer.it_interval.tv_usec = 1000000 / Profiler::SAMPLE_HZ;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, nullptr);
+}
+
+void removeSignals() {
+    struct itimerval timer = {};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    sigaction(SIGPROF, &previousProf, nullptr);
+    sigaction(SIGUSR1, &previousUsr1, nullptr);
+}
+#endif
+}
+
+// シグナルハンドラ: 割り込んだスレッドの計測器に、いまの区間と前回からのCPU時間を数える
+void profilerSampleHandler(int) {
+    Profiler* profiler = activeProfiler;
+    if (!profiler) return;
+    const uint64_t now = threadCPUNanoseconds();
+    const uint64_t elapsed = now > profiler->lastSampleCPU ? now - profiler->lastSampleCPU : 0;
+    profiler->lastSampleCPU = now;
+    const int section = static_cast<int>(profiler->current.load(std::memory_order_relaxed));
+    profiler->samples[section].fetch_add(1, std::memory_order_relaxed);
+    profiler->nanoseconds[section].fetch_add(elapsed, std::memory_order_relaxed);
+}
+
+const char* profileSectionName(ProfileSection section) {
+    const int index = static_cast<int>(section);
+    return index < ProfileStats::SECTION_COUNT ? SECTION_NAMES[index] : "unknown";
+}
+
+void ProfileStats::writeJSON(std::ostream& out) const {
+    out << "{\"enabled\":" << (enabled ? "true" : "false")
+        << ",\"sample_hz\":" << Profiler::SAMPLE_HZ
+        << ",\"samples\":" << totalSamples
+        << ",\"cpu_seconds\":" << totalNanoseconds * 1e-9
+        << ",\"wall_seconds\":" << wallSeconds
+        << ",\"sections\":{";
+    for (int i = 0; i < SECTION_COUNT; ++i) {
+        const ProfileSection section = static_cast<ProfileSection>(i);
+        out << (i ? "," : "") << "\"" << SECTION_NAMES[i] << "\":{"
+            << "\"samples\":" << samples[i]
+            << ",\"seconds\":" << seconds(section)
+            << ",\"share\":" << share(section) << "}";
+    }
+    out << "}}";
+}
+
+Profiler::Profiler() {
+    reset();
+    std::lock_guard<std::mutex> lock(installMutex);
+    dumpGeneration = dumpRequests.load(std::memory_order_relaxed);
+#ifdef GAMEBOY_PROFILE_SIGNALS
+    if (instanceCount++ == 0) {
+        installSignals();
+    }
+#endif
+}
+
+Profiler::~Profiler() {
+    std::lock_guard<std::mutex> lock(installMutex);
+#ifdef GAMEBOY_PROFILE_SIGNALS
+    if (--instanceCount == 0) {
+        removeSignals();
+    }
+#endif
+}
+
+ProfileStats Profiler::getStats() const {
+    ProfileStats stats;
+    stats.enabled = true;
+    for (int i = 0; i < ProfileStats::SECTION_COUNT; ++i) {
+        stats.samples[i] = samples[i].load(std::memory_order_relaxed);
+        stats.nanoseconds[i] = nanoseconds[i].load(std::memory_order_relaxed);
+        stats.totalSamples += stats.samples[i];
+        stats.totalNanoseconds += stats.nanoseconds[i];
+    }
+    stats.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    return stats;
+}
+
+void Profiler::reset() {
+    for (int i = 0; i < ProfileStats::SECTION_COUNT; ++i) {
+        samples[i].store(0, std::memory_order_relaxed);
+        nanoseconds[i].store(0, std::memory_order_relaxed);
+    }
+    startTime = std::chrono::steady_clock::now();
+}
+
+bool Profiler::consumeDumpRequest() {
+    const uint64_t requests = dumpRequests.load(std::memory_order_relaxed);
+    if (requests == dumpGeneration) {
+        return false;
+    }
+    dumpGeneration = requests;
+    return true;
+}
+
+ProfileThread::ProfileThread(Profiler* profiler) : saved(activeProfiler) {
+    // 入れ子で同じ計測器を登録し直すときは、前回のサンプルからの時間をそのまま数え続ける
+    if (profiler && profiler != saved) {
+        profiler->lastSampleCPU = threadCPUNanoseconds();
+    }
+    activeProfiler = profiler;
+}
+
+ProfileThread::~ProfileThread() {
+    activeProfiler = saved;
+}
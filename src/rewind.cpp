@@ -0,0 +1,174 @@
+#include "rewind.hpp"
+#include <cstring>
+
+namespace {
+void writeVarint(std::vector<uint8_t>& out, size_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// 壊れた入力で end を越えそうならfalse
+bool readVarint(const uint8_t*& p, const uint8_t* end, size_t& value) {
+    value = 0;
+    int shift = 0;
+    while (p < end && (*p & 0x80)) {
+        if (shift > 56) return false;
+        value |= static_cast<size_t>(*p++ & 0x7F) << shift;
+        shift += 7;
+    }
+    if (p >= end) return false;
+    value |= static_cast<size_t>(*p++) << shift;
+    return true;
+}
+
+// (state XOR base) を [一致バイト数][不一致バイト数][XOR値...] の並びに圧縮する
+void encodeDelta(const std::vector<uint8_t>& state, const std::vector<uint8_t>& base,
+                 std::vector<uint8_t>& out) {
+    out.clear();
+    const size_t n = state.size();
+    size_t i = 0;
+    while (i < n) {
+        size_t same = i;
+        // 一致区間は8バイトずつ比較して飛ばす
+        while (same + 8 <= n && std::memcmp(&state[same], &base[same], 8) == 0) same += 8;
+        while (same < n && state[same] == base[same]) ++same;
+        size_t diff = same;
+        while (diff < n && state[diff] != base[diff]) ++diff;
+
+        writeVarint(out, same - i);
+        writeVarint(out, diff - same);
+        for (size_t k = same; k < diff; ++k) {
+            out.push_back(state[k] ^ base[k]);
+        }
+        i = diff;
+    }
+}
+
+// 差分がstateの範囲や入力の終わりを越えていたらfalse（stateは途中まで書き換わる）
+bool decodeDelta(const uint8_t* p, const uint8_t* end, std::vector<uint8_t>& state) {
+    size_t pos = 0;
+    while (p < end) {
+        size_t same, count;
+        if (!readVarint(p, end, same) || !readVarint(p, end, count)) return false;
+        if (same > state.size() - pos || count > state.size() - pos - same ||
+            count > static_cast<size_t>(end - p)) {
+            return false;
+        }
+        pos += same;
+        for (size_t k = 0; k < count; ++k) {
+            state[pos++] ^= *p++;
+        }
+    }
+    return true;
+}
+}
+
+RewindBuffer::RewindBuffer(size_t capacityBytes, int keyframeInterval)
+    : capacity(capacityBytes), keyframeInterval(keyframeInterval > 0 ? keyframeInterval : 1) {}
+
+void RewindBuffer::clear() {
+    entries.clear();
+    needKeyframe = true;
+}
+
+size_t RewindBuffer::bytesUsed() const {
+    size_t total = 0;
+    for (const Entry& e : entries) total += e.size;
+    return total;
+}
+
+const RewindBuffer::Entry* RewindBuffer::findEntry(uint64_t seq) const {
+    if (entries.empty() || seq < entries.front().seq || seq > entries.back().seq) return nullptr;
+    return &entries[seq - entries.front().seq];  // 通し番号は連続している
+}
+
+uint8_t* RewindBuffer::allocate(size_t bytes, size_t& offset) {
+    if (!ring) {
+        ring.reset(new uint8_t[capacity]);
+    }
+    size_t head = entries.empty() ? 0 : entries.back().offset + entries.back().size;
+    const bool wrap = head + bytes > capacity;
+    offset = wrap ? 0 : head;  // 末尾に収まらなければ先頭へ折り返す
+
+    // 書き込み先と重なる古いエントリを追い出す。折り返すときは、末尾の使わなくなる領域
+    // [head, capacity) に残った前の周のエントリも追い出す（それらは先頭側のエントリより古いので、
+    // 残すと先頭の重なりを調べる前に止まってしまう）
+    while (!entries.empty()) {
+        const Entry& oldest = entries.front();
+        bool inTail = wrap && oldest.offset >= head;
+        bool overlaps = oldest.offset < offset + bytes && offset < oldest.offset + oldest.size;
+        if (!inTail && !overlaps) break;
+        bool wasKey = oldest.keyframe;
+        entries.pop_front();
+        // キーフレームを失った差分は復元できないので一緒に捨てる
+        while (wasKey && !entries.empty() && !entries.front().keyframe) {
+            entries.pop_front();
+        }
+    }
+    if (entries.empty()) {
+        offset = 0;
+    }
+    return ring.get() + offset;
+}
+
+void RewindBuffer::push(const std::vector<uint8_t>& state) {
+    if (state.size() > capacity) return;
+
+    // キーフレームが追い出されていたり、サイズが変わったらキーフレームから始め直す
+    bool asKey = needKeyframe || sinceKeyframe >= keyframeInterval ||
+                 state.size() != keyframe.size() || findEntry(keyframeSeq) == nullptr;
+    const std::vector<uint8_t>* payload = &state;
+    if (!asKey) {
+        encodeDelta(state, keyframe, scratch);
+        payload = &scratch;
+    }
+
+    Entry entry;
+    entry.size = payload->size();
+    uint8_t* dst = allocate(entry.size, entry.offset);
+    if (!asKey && findEntry(keyframeSeq) == nullptr) {
+        // 確保の際に基準キーフレームが追い出された
+        asKey = true;
+        entry.size = state.size();
+        dst = allocate(entry.size, entry.offset);
+        payload = &state;
+    }
+    std::memcpy(dst, payload->data(), entry.size);
+
+    entry.seq = nextSeq++;
+    entry.keyframe = asKey;
+    if (asKey) {
+        keyframe = state;
+        keyframeSeq = entry.seq;
+        sinceKeyframe = 0;
+        needKeyframe = false;
+    }
+    entry.keySeq = keyframeSeq;
+    ++sinceKeyframe;
+    entries.push_back(entry);
+}
+
+bool RewindBuffer::pop(std::vector<uint8_t>& state) {
+    if (entries.empty()) return false;
+
+    const Entry entry = entries.back();
+    const Entry* key = findEntry(entry.keySeq);
+    const uint8_t* keyData = ring.get() + key->offset;
+    state.assign(keyData, keyData + key->size);
+    if (!entry.keyframe) {
+        const uint8_t* delta = ring.get() + entry.offset;
+        if (!decodeDelta(delta, delta + entry.size, state)) {
+            // 本来起きない（起きたら履歴全体を信用しない）
+            clear();
+            return false;
+        }
+    }
+
+    entries.pop_back();
+    nextSeq = entry.seq;
+    needKeyframe = true;  // 以降の差分は新しいキーフレームから取り直す
+    return true;
+}
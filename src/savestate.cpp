@@ -0,0 +1,68 @@
+#include "savestate.hpp"
+#include <cstring>
+
+void StateWriter::write16(uint16_t v) {
+    write8(static_cast<uint8_t>(v));
+    write8(static_cast<uint8_t>(v >> 8));
+}
+
+void StateWriter::write32(uint32_t v) {
+    write16(static_cast<uint16_t>(v));
+    write16(static_cast<uint16_t>(v >> 16));
+}
+
+void StateWriter::write64(uint64_t v) {
+    write32(static_cast<uint32_t>(v));
+    write32(static_cast<uint32_t>(v >> 32));
+}
+
+void StateWriter::writeBytes(const uint8_t* data, size_t size) {
+    buffer.insert(buffer.end(), data, data + size);
+}
+
+void StateWriter::writeTag(const char (&tag)[5]) {
+    writeBytes(reinterpret_cast<const uint8_t*>(tag), 4);
+}
+
+uint8_t StateReader::read8() {
+    if (pos >= size) {
+        valid = false;
+        return 0;
+    }
+    return data[pos++];
+}
+
+uint16_t StateReader::read16() {
+    uint16_t lo = read8();
+    return static_cast<uint16_t>(lo | (read8() << 8));
+}
+
+uint32_t StateReader::read32() {
+    uint32_t lo = read16();
+    return lo | (static_cast<uint32_t>(read16()) << 16);
+}
+
+uint64_t StateReader::read64() {
+    uint64_t lo = read32();
+    return lo | (static_cast<uint64_t>(read32()) << 32);
+}
+
+void StateReader::readBytes(uint8_t* dst, size_t count) {
+    if (count > size - pos) {
+        valid = false;
+        std::memset(dst, 0, count);
+        pos = size;
+        return;
+    }
+    std::memcpy(dst, data + pos, count);
+    pos += count;
+}
+
+bool StateReader::expectTag(const char (&tag)[5]) {
+    uint8_t got[4];
+    readBytes(got, 4);
+    if (std::memcmp(got, tag, 4) != 0) {
+        valid = false;
+    }
+    return valid;
+}
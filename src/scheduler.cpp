@@ -0,0 +1,104 @@
+#include "scheduler.hpp"
+#include "memory.hpp"
+#include "ppu.hpp"
+#include "profiler.hpp"
+#include "savestate.hpp"
+#include "serial.hpp"
+#include "timer.hpp"
+#include <algorithm>
+#include <climits>
+
+Scheduler::Scheduler(PPU& ppu, Timer& timer, Serial& serial, Memory& memory)
+    : ppu(ppu), timer(timer), serial(serial), memory(memory)
+{
+    reset();
+}
+
+void Scheduler::reset() {
+    cycles = 0;
+    syncedTo = 0;
+    std::fill(std::begin(deadlines), std::end(deadlines), NEVER);
+    nextDeadline = 0;  // 最初の命令の前に一度同期して期限を計算する
+}
+
+void Scheduler::schedule(Event e, uint64_t when) {
+    deadlines[static_cast<int>(e)] = when;
+    updateNextDeadline();
+}
+
+void Scheduler::scheduleIn(Event e, int cyclesAhead) {
+    deadlines[static_cast<int>(e)] = (cyclesAhead < 0) ? NEVER : syncedTo + cyclesAhead;
+}
+
+void Scheduler::updateNextDeadline() {
+    nextDeadline = *std::min_element(std::begin(deadlines), std::end(deadlines));
+}
+
+void Scheduler::catchUp(uint64_t delta) {
+    // OAM DMA中はPPUのOAM参照と順序が絡むので従来通り1サイクルずつ進める
+    while (delta > 0 && memory.dmaActive) {
+        stepPPU(1);
+        stepTimer(1);
+        serial.step(1);
+        {
+            GB_PROFILE_SCOPE(profiler, ProfileSection::DMA);
+            memory.stepDMA();
+        }
+        --delta;
+    }
+
+    // それ以外は互いに干渉しないので各コンポーネントをまとめて進める
+    while (delta > 0) {
+        int chunk = static_cast<int>(std::min<uint64_t>(delta, INT_MAX));
+        stepPPU(chunk);
+        stepTimer(chunk);
+        serial.step(chunk);
+        delta -= chunk;
+    }
+}
+
+void Scheduler::stepPPU(int cycles) {
+    // 計測は進め始めた時点のモードに数える（同期はイベント単位なので1回はほぼ1モード内）
+    GB_PROFILE_SCOPE(profiler, static_cast<ProfileSection>(
+        static_cast<int>(ProfileSection::PPUHBlank) + (memory.STAT & 0x03)));
+    ppu.step(cycles);
+}
+
+void Scheduler::stepTimer(int cycles) {
+    GB_PROFILE_SCOPE(profiler, ProfileSection::Timer);
+    timer.step(cycles);
+}
+
+void Scheduler::sync() {
+    GB_PROFILE_SCOPE(profiler, ProfileSection::Events);
+    if (syncedTo < cycles) {
+        catchUp(cycles - syncedTo);
+        syncedTo = cycles;
+    }
+
+    // 各コンポーネントの次のイベントを登録し直す
+    scheduleIn(Event::PPU, ppu.cyclesUntilEvent());
+    scheduleIn(Event::Timer, timer.cyclesUntilEvent());
+    scheduleIn(Event::DMA, memory.dmaCyclesUntilEvent());
+    scheduleIn(Event::Serial, serial.cyclesUntilEvent());
+
+    // 実行ループ側の期限は過ぎたら消化済みにする
+    for (uint64_t& d : deadlines) {
+        if (d <= cycles) d = NEVER;
+    }
+    updateNextDeadline();
+}
+
+void Scheduler::saveState(StateWriter& out) const {
+    // 同期済みの状態だけを保存する（期限は同期時に各コンポーネントから再計算できる）
+    out.writeTag("SCHD");
+    out.write64(cycles);
+}
+
+void Scheduler::loadState(StateReader& in) {
+    if (!in.expectTag("SCHD")) return;
+    cycles = in.read64();
+    syncedTo = cycles;
+    std::fill(std::begin(deadlines), std::end(deadlines), NEVER);
+    nextDeadline = cycles;  // 次の命令の前に同期して期限を計算し直す
+}
@@ -0,0 +1,329 @@
+#include "sdl_frontend.hpp"
+#include "display.hpp"
+#include "emulator.hpp"
+#include "frame_pacer.hpp"
+#include "framebuffer.hpp"
+#include "movie.hpp"
+#include "rewind.hpp"
+#include "spsc_queue.hpp"
+#include "triple_buffer.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+namespace {
+// 表示スレッド → エミュレーションスレッド: キーの状態（変化したときだけ送る）
+struct ControlState {
+    uint8_t buttons = 0;       // Input::getButtonMask()形式
+    bool rewindHeld = false;
+    bool turboHeld = false;
+
+    bool operator!=(const ControlState& other) const {
+        return buttons != other.buttons || rewindHeld != other.rewindHeld || turboHeld != other.turboHeld;
+    }
+};
+
+// エミュレーションスレッド → 表示スレッド: 完成したフレーム
+// PPUが描いたラインをARGBに変換して直接ここへ書き込む（表示側は行をコピーするだけ）
+struct FrameSlot {
+    static constexpr int PITCH = SCREEN_WIDTH * 4;
+
+    alignas(64) uint8_t pixels[PITCH * SCREEN_HEIGHT];
+    uint64_t lineHashes[SCREEN_HEIGHT];   // 各行に入っている内容のハッシュ
+
+    FrameTarget target() {
+        FrameTarget t;
+        t.pixels = pixels;
+        t.pitch = PITCH;
+        t.format = PixelFormat::ARGB8888;
+        t.lineHashes = lineHashes;
+        return t;
+    }
+};
+
+void printProfile(const char* label, const ProfileStats& profile) {
+    if (profile.enabled) {
+        std::cout << "[INFO] 計測(" << label << "): ";
+        profile.writeJSON(std::cout);
+        std::cout << "\n";
+    }
+}
+}
+
+struct SDLFrontend::Channels {
+    TripleBuffer<FrameSlot> frames;
+    SPSCQueue<ControlState, 64> controls;
+    std::atomic<bool> stop{false};       // 表示スレッドが終了を決めた
+    TimelineRecorder* timeline = nullptr;
+    uint8_t initialButtons = 0;
+    uint64_t publishedFrames = 0;        // エミュレーションスレッドが公開した数（join後に読む）
+    uint64_t presentedFrames = 0;        // 表示スレッドが表示した数
+    ProfileStats displayProfile;         // 表示スレッドの計測値
+};
+
+SDLFrontend::SDLFrontend(Emulator& emu, const FrontendOptions& options)
+    : emu(emu), options(options), display(std::make_unique<Display>()) {}
+
+SDLFrontend::~SDLFrontend() = default;
+
+void SDLFrontend::run() {
+    std::cout << "Initializing display...\n";
+
+    if (!display->init()) {
+        std::cerr << "Failed to initialize display. Falling back to console mode.\n";
+        emu.run().writeJSON(std::cout);
+        std::cout << std::endl;
+        return;
+    }
+
+    std::cout << "Emulator running with SDL2 display...\n";
+
+    // 受け渡しの面（フレーム3枚ぶん）はスタックに置かない
+    auto channels = std::make_unique<Channels>();
+    // 先読み中はエミュレーションスレッドが記録器を外すので、ここで控えておく
+    channels->timeline = emu.getTimeline();
+    channels->initialButtons = emu.getButtonMask();
+
+    // SDLのイベント処理は呼び出したスレッド（通常はメインスレッド）に残す
+    std::thread emulation([this, &channels] { emulationLoop(*channels); });
+    displayLoop(*channels);
+    channels->stop.store(true, std::memory_order_release);
+    emulation.join();
+
+    // 表示が追いつかなかったフレームは、トリプルバッファ上で新しいフレームに上書きされている
+    std::cout << "[INFO] 表示フレーム数: " << channels->presentedFrames << " (公開 "
+              << channels->publishedFrames << ", 未表示 "
+              << (channels->publishedFrames - std::min(channels->publishedFrames, channels->presentedFrames))
+              << ")\n";
+    printProfile("表示", channels->displayProfile);
+}
+
+void SDLFrontend::emulationLoop(Channels& channels) {
+    GB_PROFILE_THREAD(emu.getProfiler());
+    TimelineRecorder* const timeline = channels.timeline;
+
+    // テスト結果の文字列が来たら一度だけ表示する
+    SerialMatcher serialMatcher({"Passed", "Failed"});
+    bool testFinished = false;
+    bool speculating = false;   // 先読み中（あとで巻き戻すフレーム）
+    std::string serialText;
+    emu.setSerialSink([&](uint8_t byte) {
+        if (speculating) {
+            return;  // 巻き戻した後の本番のフレームで改めて届く
+        }
+        serialText += static_cast<char>(byte);
+        if (!testFinished && serialMatcher.feed(byte) >= 0) {
+            testFinished = true;
+            std::cout << "\n[INFO] テスト完了: " << serialText << "\n";
+        }
+    });
+
+    // フレーム数・サイクル数とも64bitマスタークロック基準（上限なし）
+    uint64_t frameCount = 0;
+    const uint64_t startCycle = emu.getCycleCount();
+
+    // エミュレーションは実機のフレームレートに合わせる（Tab押下中は無制限）
+    FramePacer pacer(options.speed);
+
+    // 巻き戻し履歴（フレーム境界ごとにスナップショットを積む）
+    RewindBuffer rewind(options.rewindBytes);
+    std::vector<uint8_t> snapshot;
+
+    // ムービー記録（開始状態＋ボタン変化＋フレームごとの状態ハッシュ）
+    const bool recording = !options.movieRecordPath.empty();
+    Movie movie;
+    uint8_t recordedButtons = emu.getButtonMask();
+    if (recording) {
+        movie.romHash = emu.getROMHash();
+        emu.saveState(movie.startState);
+    }
+
+    // 表示スレッドから届いたキーの状態を反映する（終了が決まっていればfalse）
+    ControlState control;
+    control.buttons = channels.initialButtons;
+    auto pollControls = [&]() {
+        bool changed = false;
+        ControlState next;
+        while (channels.controls.pop(next)) {
+            control = next;
+            changed = true;
+        }
+        if (changed) {
+            emu.setButtonMask(control.buttons);
+        }
+        pacer.setTurbo(control.turboHeld);
+        return !channels.stop.load(std::memory_order_acquire);
+    };
+
+    // いまのフレームを公開する（表示スレッドは最新の1枚だけを拾う）
+    // PPUが描かなかった行（巻き戻し・描画を省いた先読み・別の面に描いた行）だけここで変換して補う
+    emu.setFrameTarget(channels.frames.writeBuffer().target());
+    auto publishFrame = [&]() {
+        FrameSlot& slot = channels.frames.writeBuffer();
+        syncFrameTarget(emu.getFrameBuffer(), emu.getLineHashes(), slot.target());
+        channels.frames.publish();
+        ++channels.publishedFrames;
+        emu.setFrameTarget(channels.frames.writeBuffer().target());
+    };
+
+    // 先読み（run-ahead）: 入力を反映したNフレーム先の画面を表示し、本来の進行は保存した時点へ戻す
+    using Clock = std::chrono::steady_clock;
+    const PPU::RenderMode renderMode = emu.getRenderMode();
+    const int renderInterval = emu.getRenderInterval();
+    std::vector<uint8_t> runAheadSnapshot;
+    double runAheadTotalMs = 0.0, runAheadMaxMs = 0.0, snapshotSaveUs = 0.0, snapshotRestoreUs = 0.0;
+
+    while (true) {
+        emu.runFrame();
+        if (options.runAheadFrames > 0) {
+            const auto aheadStart = Clock::now();
+            const uint64_t timelineStart = timeline ? timeline->hostNow() : 0;
+            emu.saveSnapshot(runAheadSnapshot);
+            const auto saved = Clock::now();
+            speculating = true;
+            emu.setTimeline(nullptr);  // 巻き戻すフレームのゲーム側の出来事は記録しない
+            for (int ahead = 1; ahead <= options.runAheadFrames; ++ahead) {
+                // 表示に残るのは直近2フレームで描いたラインだけなので、それより前は描画を省く
+                const bool visible = ahead + 1 >= options.runAheadFrames;
+                emu.setRenderMode(visible ? renderMode : PPU::RenderMode::TimingOnly, renderInterval);
+                emu.runFrame();
+            }
+            publishFrame();
+            emu.setRenderMode(renderMode, renderInterval);
+            const auto restoreStart = Clock::now();
+            emu.restoreSnapshot(runAheadSnapshot);
+            speculating = false;
+            emu.setTimeline(timeline);
+            const auto aheadEnd = Clock::now();
+            if (timeline) {
+                timeline->hostSpan("run-ahead", timelineStart, timeline->hostNow(),
+                                   "frames", options.runAheadFrames);
+            }
+
+            const double ms = std::chrono::duration<double, std::milli>(aheadEnd - aheadStart).count();
+            runAheadTotalMs += ms;
+            runAheadMaxMs = std::max(runAheadMaxMs, ms);
+            snapshotSaveUs += std::chrono::duration<double, std::micro>(saved - aheadStart).count();
+            snapshotRestoreUs += std::chrono::duration<double, std::micro>(aheadEnd - restoreStart).count();
+        } else {
+            publishFrame();
+        }
+        frameCount++;
+
+        bool quit = !pollControls();
+
+        // 巻き戻しキーを押している間は、エミュレーションを止めて1フレームずつ過去へ戻る
+        bool rewound = false;
+        while (!quit && options.rewindBytes > 0 && control.rewindHeld && rewind.pop(snapshot)) {
+            emu.loadState(snapshot.data(), snapshot.size());
+            publishFrame();
+            rewound = true;
+            pacer.waitForNextFrame();
+            quit = !pollControls();
+        }
+        if (quit) {
+            break;
+        }
+        if (!rewound && options.rewindBytes > 0) {
+            emu.saveState(snapshot);
+            rewind.push(snapshot);
+        }
+
+        if (recording) {
+            const uint64_t now = emu.getCycleCount();
+            if (rewound) {
+                // 巻き戻した先から記録し直す
+                while (!movie.inputs.empty() && movie.inputs.back().cycle > now) movie.inputs.pop_back();
+                while (!movie.checkpoints.empty() && movie.checkpoints.back().cycle >= now) movie.checkpoints.pop_back();
+                recordedButtons = emu.getButtonMask();
+            }
+            if (emu.getButtonMask() != recordedButtons) {
+                recordedButtons = emu.getButtonMask();
+                movie.inputs.push_back({now, recordedButtons});
+            }
+            movie.checkpoints.push_back({now, emu.getStateHash()});
+        }
+
+        const uint64_t waitStart = timeline ? timeline->hostNow() : 0;
+        pacer.waitForNextFrame();
+        if (timeline) {
+            timeline->hostSpan("frame pacing", waitStart, timeline->hostNow());
+        }
+    }
+    emu.setSerialSink(nullptr);
+    emu.setFrameTarget({});
+
+    if (recording && movie.save(options.movieRecordPath)) {
+        std::cout << "[INFO] ムービーを保存: " << options.movieRecordPath << " (" << movie.inputs.size()
+                  << " inputs, " << movie.checkpoints.size() << " frames)\n";
+    }
+    std::cout << "[INFO] 最終サイクル数: " << (emu.getCycleCount() - startCycle) << "\n";
+    std::cout << "[INFO] エミュレーションフレーム数: " << frameCount << "\n";
+
+    const FramePacer::Stats stats = pacer.getStats();
+    std::cout << std::fixed << std::setprecision(2)
+              << "[INFO] フレーム時間(直近" << stats.frames << "): 平均 " << stats.meanMs << "ms ("
+              << stats.fps << "fps), p50 " << stats.p50Ms << "ms, p90 " << stats.p90Ms
+              << "ms, p99 " << stats.p99Ms << "ms, 最大 " << stats.maxMs << "ms\n"
+              << "[INFO] ジッタ: p50 " << stats.jitterP50Ms << "ms, p99 " << stats.jitterP99Ms << "ms\n";
+    if (options.runAheadFrames > 0 && frameCount > 0) {
+        std::cout << "[INFO] 先読み(" << options.runAheadFrames << "フレーム)のコスト: 平均 "
+                  << runAheadTotalMs / frameCount << "ms/フレーム, 最大 " << runAheadMaxMs << "ms"
+                  << " (保存 " << snapshotSaveUs / frameCount << "us, 復元 "
+                  << snapshotRestoreUs / frameCount << "us)\n";
+    }
+    std::cout << std::defaultfloat;
+
+    printProfile("エミュレーション", emu.getProfileStats());
+}
+
+void SDLFrontend::displayLoop(Channels& channels) {
+    // 表示スレッドは自分の計測器を持つ（区間の状態はスレッドごとに別でないと混ざる）
+#ifdef GAMEBOY_PROFILE
+    Profiler profiler;
+    Profiler* const displayProfiler = &profiler;
+#else
+    Profiler* const displayProfiler = nullptr;
+#endif
+    GB_PROFILE_THREAD(displayProfiler);
+    display->setProfiler(displayProfiler);
+    display->setTimeline(channels.timeline);
+
+    // キーの割り当てはDisplay::handleEventsのものを使い、手元のInputで押下状態だけを持つ
+    Input keys;
+    keys.setButtonMask(channels.initialButtons);
+    ControlState sent;
+    sent.buttons = channels.initialButtons;
+    uint64_t presentedFrames = 0;
+
+    while (true) {
+        if (!display->handleEvents(&keys)) {
+            std::cout << "\n[INFO] ユーザーによる終了\n";
+            break;
+        }
+        ControlState state;
+        state.buttons = keys.getButtonMask();
+        state.rewindHeld = display->isRewindHeld();
+        state.turboHeld = display->isTurboHeld();
+        // キューが満杯なら送らずにおき、次の周回で最新の状態を送り直す
+        if (state != sent && channels.controls.push(state)) {
+            sent = state;
+        }
+
+        if (channels.frames.update()) {
+            const FrameSlot& frame = channels.frames.readBuffer();
+            display->updateFrame(frame.pixels, FrameSlot::PITCH, frame.lineHashes);
+            ++presentedFrames;
+        } else {
+            // 新しいフレームがまだ無い。入力の遅れが1ms以内に収まる間隔で見に行く
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    channels.presentedFrames = presentedFrames;
+#ifdef GAMEBOY_PROFILE
+    channels.displayProfile = profiler.getStats();
+#endif
+}
@@ -0,0 +1,120 @@
+#include "serial.hpp"
+#include "memory.hpp"
+#include "savestate.hpp"
+#include <queue>
+
+Serial::Serial(Memory* mem)
+    : memory(mem) {}
+
+void Serial::reset() {
+    transferActive = false;
+    cyclesRemaining = 0;
+}
+
+void Serial::writeSB(uint8_t val) {
+    memory->SB = val;
+}
+
+void Serial::writeSC(uint8_t val) {
+    memory->SC = val;
+    if ((val & 0x81) == 0x81) {
+        // 内部クロックで転送開始
+        transferActive = true;
+        cyclesRemaining = TRANSFER_CYCLES;
+    } else if ((val & 0x80) == 0) {
+        transferActive = false;  // 転送中止
+    }
+    // 外部クロック(bit0=0)は相手がいないので完了しない
+}
+
+void Serial::step(int cycles) {
+    if (!transferActive) return;
+    cyclesRemaining -= cycles;
+    if (cyclesRemaining <= 0) {
+        completeTransfer();
+    }
+}
+
+int Serial::cyclesUntilEvent() const {
+    return transferActive ? cyclesRemaining : -1;
+}
+
+void Serial::completeTransfer() {
+    transferActive = false;
+    uint8_t sent = memory->SB;
+    memory->SB = 0xFF;          // 相手なし: 1が入ってくる
+    memory->SC &= 0x7F;         // 転送完了
+    memory->if_reg |= 0x08;     // シリアル割り込み要求
+    if (sink) {
+        sink(sent);
+    }
+}
+
+void Serial::saveState(StateWriter& out) const {
+    out.writeTag("SERL");
+    out.writeBool(transferActive);
+    out.write32(static_cast<uint32_t>(cyclesRemaining));
+}
+
+void Serial::loadState(StateReader& in) {
+    if (!in.expectTag("SERL")) return;
+    transferActive = in.readBool();
+    cyclesRemaining = static_cast<int>(in.read32());
+}
+
+SerialMatcher::SerialMatcher(const std::vector<std::string>& patterns) {
+    // トライを作る
+    transitions.emplace_back();
+    transitions[0].fill(-1);
+    matchAt.push_back(-1);
+    for (size_t p = 0; p < patterns.size(); ++p) {
+        int node = 0;
+        for (unsigned char c : patterns[p]) {
+            if (transitions[node][c] < 0) {
+                transitions[node][c] = static_cast<int>(transitions.size());
+                transitions.emplace_back();
+                transitions.back().fill(-1);
+                matchAt.push_back(-1);
+            }
+            node = transitions[node][c];
+        }
+        if (matchAt[node] < 0) {
+            matchAt[node] = static_cast<int>(p);
+        }
+    }
+
+    // 失敗リンクをたどって全遷移を埋める（BFS順）
+    std::vector<int> fail(transitions.size(), 0);
+    std::queue<int> queue;
+    for (int c = 0; c < 256; ++c) {
+        int child = transitions[0][c];
+        if (child < 0) {
+            transitions[0][c] = 0;
+        } else {
+            fail[child] = 0;
+            queue.push(child);
+        }
+    }
+    while (!queue.empty()) {
+        int node = queue.front();
+        queue.pop();
+        if (matchAt[node] < 0) {
+            matchAt[node] = matchAt[fail[node]];  // 接尾辞として含まれるパターン
+        }
+        for (int c = 0; c < 256; ++c) {
+            int child = transitions[node][c];
+            if (child < 0) {
+                transitions[node][c] = transitions[fail[node]][c];
+            } else {
+                fail[child] = transitions[fail[node]][c];
+                queue.push(child);
+            }
+        }
+    }
+}
+
+int SerialMatcher::feed(uint8_t byte) {
+    if (transitions.empty()) return -1;
+    state = transitions[state][byte];
+    return matchAt[state];
+}
@@ -0,0 +1,138 @@
+#include "timeline.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+namespace {
+constexpr double CYCLES_PER_MICROSECOND = 4.194304;
+
+std::atomic<uint64_t> nextRecorderId{1};
+
+// スレッドごとに直近に使ったバッファを覚えておく（同じ記録器なら登録を省く）
+struct ThreadCache {
+    uint64_t recorderId = 0;
+    void* buffer = nullptr;
+};
+thread_local ThreadCache threadCache;
+
+const char* const TRACK_NAMES[] = {"PPU", "CPU", "DMA"};
+
+void writeArgs(std::ostream& out, const char* argName, int64_t arg) {
+    if (argName) {
+        out << ",\"args\":{\"" << argName << "\":" << arg << "}";
+    }
+}
+}
+
+TimelineRecorder::TimelineRecorder(size_t maxEventsPerThread)
+    : maxEventsPerThread(maxEventsPerThread),
+      startTime(std::chrono::steady_clock::now()),
+      id(nextRecorderId.fetch_add(1)) {
+}
+
+TimelineRecorder::ThreadBuffer& TimelineRecorder::threadBuffer() {
+    if (threadCache.recorderId != id) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        buffers.push_back(std::make_unique<ThreadBuffer>());
+        buffers.back()->index = static_cast<int>(buffers.size() - 1);
+        buffers.back()->events.reserve(std::min<size_t>(maxEventsPerThread, 1u << 16));
+        threadCache.recorderId = id;
+        threadCache.buffer = buffers.back().get();
+    }
+    return *static_cast<ThreadBuffer*>(threadCache.buffer);
+}
+
+void TimelineRecorder::append(const Event& event) {
+    ThreadBuffer& buffer = threadBuffer();
+    if (buffer.events.size() >= maxEventsPerThread) {
+        ++buffer.dropped;
+        return;
+    }
+    buffer.events.push_back(event);
+}
+
+void TimelineRecorder::guestSpan(Track track, const char* name, uint64_t startCycle, uint64_t cycles,
+                                 const char* argName, int64_t arg) {
+    append({name, argName, startCycle, cycles, arg, static_cast<uint8_t>(track), false});
+}
+
+void TimelineRecorder::guestInstant(Track track, const char* name, uint64_t cycle,
+                                    const char* argName, int64_t arg) {
+    append({name, argName, cycle, 0, arg, static_cast<uint8_t>(track), true});
+}
+
+uint64_t TimelineRecorder::hostNow() const {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - startTime).count());
+}
+
+void TimelineRecorder::hostSpan(const char* name, uint64_t startNs, uint64_t endNs,
+                                const char* argName, int64_t arg) {
+    append({name, argName, startNs, endNs > startNs ? endNs - startNs : 0, arg, HOST_TRACK, false});
+}
+
+size_t TimelineRecorder::eventCount() const {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    size_t count = 0;
+    for (const auto& buffer : buffers) {
+        count += buffer->events.size();
+    }
+    return count;
+}
+
+size_t TimelineRecorder::droppedCount() const {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    size_t count = 0;
+    for (const auto& buffer : buffers) {
+        count += buffer->dropped;
+    }
+    return count;
+}
+
+bool TimelineRecorder::writeJSON(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "[TIMELINE] Failed to open " << path << std::endl;
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    // pid 1 = ゲーム時間（1us = 4.194304サイクル）、pid 2 = ホストの実時間
+    // tidはスレッド（記録したエミュレータ）ごとに、ゲーム側はトラック数ぶん割り当てる
+    constexpr int TRACKS = static_cast<int>(Track::Count);
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+        << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":1,\"args\":{\"name\":\"guest (emulated time)\"}},\n"
+        << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":2,\"args\":{\"name\":\"host (wall time)\"}}";
+    for (const auto& buffer : buffers) {
+        for (int t = 0; t < TRACKS; ++t) {
+            out << ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << buffer->index * TRACKS + t
+                << ",\"args\":{\"name\":\"emu" << buffer->index << " " << TRACK_NAMES[t] << "\"}}";
+        }
+        out << ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":2,\"tid\":" << buffer->index
+            << ",\"args\":{\"name\":\"thread" << buffer->index << "\"}}";
+    }
+
+    char number[64];
+    for (const auto& buffer : buffers) {
+        for (const Event& e : buffer->events) {
+            const bool host = e.track == HOST_TRACK;
+            const double scale = host ? 1e-3 : 1.0 / CYCLES_PER_MICROSECOND;
+            out << ",\n{\"name\":\"" << e.name << "\",\"pid\":" << (host ? 2 : 1)
+                << ",\"tid\":" << (host ? buffer->index : buffer->index * TRACKS + e.track);
+            std::snprintf(number, sizeof(number), "%.3f", e.start * scale);
+            out << ",\"ts\":" << number;
+            if (e.instant) {
+                out << ",\"ph\":\"i\",\"s\":\"t\"";
+            } else {
+                std::snprintf(number, sizeof(number), "%.3f", e.duration * scale);
+                out << ",\"ph\":\"X\",\"dur\":" << number;
+            }
+            writeArgs(out, e.argName, e.arg);
+            out << "}";
+        }
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
@@ -1,5 +1,6 @@
 #include "timer.hpp"
 #include "memory.hpp"
+#include "savestate.hpp"
 
 Timer::Timer(Memory* mem)
     : memory(mem), divCounter(0) {}
@@ -9,34 +10,81 @@ void Timer::reset() {
     memory->DIV = 0;
 }
 
+namespace {
+constexpr int bitMap[4] = {9, 3, 5, 7};  // TAC下位2bit → 監視するdivCounterのビット
+}
+
+bool Timer::timerSignal(uint8_t tac, uint16_t counter) {
+    // TIMAのクロック = (TAC有効) AND (監視ビット)。この信号の立ち下がりでTIMAが進む
+    return (tac & 0x04) && ((counter >> bitMap[tac & 0x03]) & 0x01);
+}
+
+void Timer::incrementTIMA(uint32_t count) {
+    // count回分のTIMA加算をまとめて行う（オーバーフローごとにTMA再ロード＋割り込み）
+    while (count > 0) {
+        uint32_t toOverflow = 0x100u - memory->TIMA;
+        if (count < toOverflow) {
+            memory->TIMA = static_cast<uint8_t>(memory->TIMA + count);
+            return;
+        }
+        count -= toOverflow;
+        memory->TIMA = memory->TMA;
+        memory->if_reg |= 0x04;
+    }
+}
+
 void Timer::step(int cycles) {
-    if (memory->DIV == 0 && ((divCounter >> 8) & 0xFF) != 0) {
-        divCounter = 0;
+    // 1サイクルずつ数えずに、区間内の立ち下がりエッジ数を算術的に求める
+    uint8_t tac = memory->TAC;
+    if (tac & 0x04) {
+        uint32_t period = 1u << (bitMap[tac & 0x03] + 1);
+        uint32_t phase = divCounter & (period - 1);
+        incrementTIMA((phase + static_cast<uint32_t>(cycles)) / period);
     }
 
-    static constexpr int bitMap[4] = {9, 3, 5, 7};
+    divCounter = static_cast<uint16_t>(divCounter + cycles);
+    memory->DIV = static_cast<uint8_t>((divCounter >> 8) & 0xFF);
+}
 
-    for (int i = 0; i < cycles; ++i) {
-        uint16_t prevDiv = divCounter;
-        ++divCounter;
-        memory->DIV = static_cast<uint8_t>((divCounter >> 8) & 0xFF);
+void Timer::writeDIV() {
+    // カウンタのリセットで監視ビットが1→0になると、その場でTIMAが1進む
+    bool before = timerSignal(memory->TAC, divCounter);
+    divCounter = 0;
+    memory->DIV = 0;
+    if (before) {
+        incrementTIMA(1);
+    }
+}
 
-        uint8_t tac = memory->TAC;
-        if ((tac & 0x04) == 0) {
-            continue;
-        }
+void Timer::writeTAC(uint8_t val) {
+    // 有効ビット/周波数の切り替えでも信号が1→0になればTIMAが1進む
+    bool before = timerSignal(memory->TAC, divCounter);
+    memory->TAC = val;
+    bool after = timerSignal(val, divCounter);
+    if (before && !after) {
+        incrementTIMA(1);
+    }
+}
 
-        int bit = bitMap[tac & 0x03];
-        bool prevBit = (prevDiv >> bit) & 0x01;
-        bool currBit = (divCounter >> bit) & 0x01;
-
-        if (prevBit && !currBit) {
-            if (memory->TIMA == 0xFF) {
-                memory->TIMA = memory->TMA;
-                memory->if_reg |= 0x04;
-            } else {
-                ++memory->TIMA;
-            }
-        }
+int Timer::cyclesUntilEvent() const {
+    if ((memory->TAC & 0x04) == 0) {
+        return -1;
     }
+    // 次のTIMAオーバーフロー（＝タイマー割り込み）までのサイクル数
+    // 監視ビットの立ち下がり = divCounter が周期の倍数になる瞬間
+    int period = 1 << (bitMap[memory->TAC & 0x03] + 1);
+    int firstEdge = period - (divCounter & (period - 1));
+    int edgesToOverflow = 0x100 - memory->TIMA;
+    return firstEdge + (edgesToOverflow - 1) * period;
+}
+
+void Timer::saveState(StateWriter& out) const {
+    // DIV/TIMA/TMA/TACはMemory側で保存される
+    out.writeTag("TIMR");
+    out.write16(divCounter);
+}
+
+void Timer::loadState(StateReader& in) {
+    if (!in.expectTag("TIMR")) return;
+    divCounter = in.read16();
 }
@@ -0,0 +1,272 @@
+#include "vec_emulator.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <unordered_map>
+
+double VecStats::averageFramesPerSecond() const {
+    return totalStepSeconds > 0.0 ? envFrames / totalStepSeconds : 0.0;
+}
+
+double VecStats::instructionsPerSecond() const {
+    return totalStepSeconds > 0.0 ? instructions / totalStepSeconds : 0.0;
+}
+
+VecEmulator::VecEmulator(size_t envCount, size_t threads)
+    : envCount(envCount),
+      envs(new Emulator[envCount]),
+      frameInEpisode(envCount, 0),
+      resetFlags(envCount, 0),
+      stepInstructions(envCount, 0),
+      pool(threads),
+      groupOf(envCount, 0),
+      leaderOf(envCount, 0),
+      hasFollowers(envCount, 0),
+      groupState(envCount) {
+}
+
+bool VecEmulator::loadROM(const std::string& path, uint64_t warmupFrames) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to open ROM: " << path << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return loadROMData(data.data(), data.size(), warmupFrames);
+}
+
+bool VecEmulator::loadROMData(const uint8_t* data, size_t size, uint64_t warmupFrames) {
+    if (envCount == 0 || !envs[0].loadROMData(data, size)) {
+        return false;
+    }
+    for (uint64_t i = 0; i < warmupFrames; ++i) {
+        envs[0].runFrame();
+    }
+    envs[0].saveState(startState);
+
+    // 他の環境はROMを読んでからスタート状態を読み込む（ROMハッシュの照合が通る）
+    std::atomic<bool> ok{true};
+    forEachShard(envCount, [&](size_t begin, size_t end) {
+        for (size_t i = std::max<size_t>(begin, 1); i < end; ++i) {
+            if (!envs[i].loadROMData(data, size)) {
+                ok = false;
+            }
+        }
+    });
+    if (!ok) {
+        return false;
+    }
+    reset(nullptr);
+    return true;
+}
+
+bool VecEmulator::setStartState(const uint8_t* data, size_t size) {
+    // 先頭の環境で読めることを確かめてから差し替える
+    if (envCount == 0 || !envs[0].loadState(data, size)) {
+        return false;
+    }
+    startState.assign(data, data + size);
+    reset(nullptr);
+    return true;
+}
+
+void VecEmulator::setObservation(ObservationType type) {
+    observation = type;
+    const PPU::RenderMode mode = type == ObservationType::RAM
+        ? PPU::RenderMode::TimingOnly : PPU::RenderMode::Full;
+    for (size_t i = 0; i < envCount; ++i) {
+        envs[i].setRenderMode(mode);
+    }
+}
+
+size_t VecEmulator::observationSize() const {
+    switch (observation) {
+        case ObservationType::PackedFrame: return FRAME_BYTES;
+        case ObservationType::Gray8Frame:  return SCREEN_WIDTH * SCREEN_HEIGHT;
+        case ObservationType::RAM:         return RAM_OBSERVATION_BYTES;
+    }
+    return 0;
+}
+
+void VecEmulator::setLockstep(bool enabled) {
+    lockstep = enabled;
+    // 有効にした時点では同一かどうか分からないので、全環境を別々のグループから始める
+    for (size_t i = 0; i < envCount; ++i) {
+        groupOf[i] = nextGroup++;
+    }
+}
+
+Emulator& VecEmulator::env(size_t index) {
+    groupOf[index] = nextGroup++;
+    return envs[index];
+}
+
+void VecEmulator::reset(uint8_t* observations) {
+    forEachShard(envCount, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            resetEnv(i);
+            if (observations) {
+                writeObservation(i, observations);
+            }
+        }
+    });
+    // 全環境がスタート状態にそろった
+    std::fill(groupOf.begin(), groupOf.end(), nextGroup++);
+}
+
+void VecEmulator::step(const uint8_t* actions, uint8_t* observations, uint8_t* dones) {
+    const auto wallStart = std::chrono::steady_clock::now();
+
+    size_t executed = envCount;
+    if (lockstep) {
+        stepLockstep(actions, observations);
+        executed = leaders.size();
+    } else {
+        forEachShard(envCount, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                advanceEnv(i, actions ? actions[i] : 0, observations);
+            }
+        });
+    }
+    if (dones) {
+        std::copy(resetFlags.begin(), resetFlags.end(), dones);
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    ++stats.steps;
+    stats.envFrames += envCount;
+    stats.executedFrames += executed;
+    stats.lastGroups = executed;
+    stats.resets += std::count(resetFlags.begin(), resetFlags.end(), 1);
+    uint64_t stepTotal = 0;
+    for (uint64_t count : stepInstructions) {
+        stepTotal += count;
+    }
+    stats.instructions += stepTotal;
+    if (lockstep) {
+        for (size_t i : leaders) {
+            stats.executedInstructions += stepInstructions[i];
+        }
+    } else {
+        stats.executedInstructions += stepTotal;
+    }
+    stats.lastStepSeconds = seconds;
+    stats.lastFramesPerSecond = seconds > 0.0 ? envCount / seconds : 0.0;
+    stats.totalStepSeconds += seconds;
+}
+
+void VecEmulator::advanceEnv(size_t index, uint8_t action, uint8_t* observations) {
+    Emulator& emu = envs[index];
+    const uint64_t instructionsBefore = emu.getInstructionCount();
+    emu.setButtonMask(action);
+    emu.runFrame();
+    ++frameInEpisode[index];
+    stepInstructions[index] = emu.getInstructionCount() - instructionsBefore;
+
+    const bool done = (episodeFrames != 0 && frameInEpisode[index] >= episodeFrames)
+        || (doneCondition && doneCondition(emu));
+    resetFlags[index] = done ? 1 : 0;
+    if (done) {
+        resetEnv(index);
+    }
+    if (observations) {
+        writeObservation(index, observations);
+    }
+}
+
+void VecEmulator::stepLockstep(const uint8_t* actions, uint8_t* observations) {
+    // (グループ, 行動) が同じ環境を1つにまとめ、最初に現れた環境をリーダーにする
+    leaders.clear();
+    followers.clear();
+    std::unordered_map<uint64_t, size_t> leaderByKey;
+    for (size_t i = 0; i < envCount; ++i) {
+        const uint8_t action = actions ? actions[i] : 0;
+        auto [it, inserted] = leaderByKey.try_emplace(groupOf[i] * 256 + action, i);
+        leaderOf[i] = it->second;
+        hasFollowers[i] = 0;
+        if (inserted) {
+            leaders.push_back(i);
+        } else {
+            followers.push_back(i);
+            hasFollowers[it->second] = 1;
+        }
+    }
+
+    // リーダーだけを実行し、フォロワーがいれば状態を配布用に保存する
+    forEachShard(leaders.size(), [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            const size_t i = leaders[k];
+            advanceEnv(i, actions ? actions[i] : 0, observations);
+            if (hasFollowers[i]) {
+                envs[i].saveState(groupState[i]);
+            }
+        }
+    });
+
+    // フォロワーはリーダーの状態・カウンタ・観測をそのまま写す
+    const size_t obsSize = observationSize();
+    forEachShard(followers.size(), [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            const size_t i = followers[k];
+            const size_t leader = leaderOf[i];
+            envs[i].cloneState(envs[leader], groupState[leader]);
+            frameInEpisode[i] = frameInEpisode[leader];
+            resetFlags[i] = resetFlags[leader];
+            stepInstructions[i] = stepInstructions[leader];
+            if (observations) {
+                std::memcpy(observations + i * obsSize, observations + leader * obsSize, obsSize);
+            }
+        }
+    });
+
+    // グループ番号を振り直す。このフレームでリセットした環境はすべてスタート状態で同一
+    const uint64_t resetGroup = nextGroup++;
+    for (size_t i : leaders) {
+        groupOf[i] = resetFlags[i] ? resetGroup : nextGroup++;
+    }
+    for (size_t i : followers) {
+        groupOf[i] = groupOf[leaderOf[i]];
+    }
+}
+
+void VecEmulator::forEachShard(size_t count, const std::function<void(size_t, size_t)>& body) {
+    const size_t shards = pool.size() * 4;
+    const size_t shardSize = std::max<size_t>(1, (count + shards - 1) / shards);
+    if (pool.size() <= 1 || count <= shardSize) {
+        body(0, count);
+        return;
+    }
+    for (size_t begin = 0; begin < count; begin += shardSize) {
+        const size_t end = std::min(count, begin + shardSize);
+        pool.submit([&body, begin, end] { body(begin, end); });
+    }
+    pool.wait();
+}
+
+void VecEmulator::resetEnv(size_t index) {
+    // 直前の状態に関係なく読める（startStateは読み込み済みのROMで作ったもの）
+    envs[index].loadState(startState.data(), startState.size());
+    frameInEpisode[index] = 0;
+}
+
+void VecEmulator::writeObservation(size_t index, uint8_t* observations) const {
+    const Emulator& emu = envs[index];
+    uint8_t* dst = observations + index * observationSize();
+    switch (observation) {
+        case ObservationType::PackedFrame:
+            std::memcpy(dst, emu.getFrameBuffer(), FRAME_BYTES);
+            break;
+        case ObservationType::Gray8Frame:
+            emu.copyFrame(dst, SCREEN_WIDTH, PixelFormat::Gray8);
+            break;
+        case ObservationType::RAM:
+            std::memcpy(dst, emu.getWRAM(), 0x2000);
+            std::memcpy(dst + 0x2000, emu.getHRAM(), 0x7F);
+            dst[0x2000 + 0x7F] = emu.readByte(0xFFFF);
+            break;
+    }
+}
@@ -0,0 +1,97 @@
+// 別々のROMを読み込んだ複数のEmulatorを別スレッドで同時に回し、単独で回した結果と一致することを確かめる
+// （インスタンス間で状態を共有していると画面や状態のハッシュがずれる）
+#include "emulator.hpp"
+#include "farm.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr uint64_t FRAMES = 300;
+
+struct Outcome {
+    bool loaded = false;
+    uint64_t frameHash = 0;
+    uint64_t stateHash = 0;
+};
+
+Outcome runROM(const std::string& path) {
+    Outcome outcome;
+    Emulator emu;
+    if (!emu.loadROM(path)) return outcome;
+    outcome.loaded = true;
+    for (uint64_t i = 0; i < FRAMES; ++i) {
+        emu.runFrame();
+    }
+    outcome.frameHash = emu.getFrameHash();
+    outcome.stateHash = emu.getStateHash();
+    return outcome;
+}
+}
+
+int main(int argc, char** argv) {
+    const std::string romDir = argc > 1 ? argv[1] : "roms";
+    const std::vector<std::string> roms = collectROMs({romDir});
+    if (roms.size() < 2) {
+        std::fprintf(stderr, "need at least two ROMs in %s\n", romDir.c_str());
+        return 1;
+    }
+    int failures = 0;
+
+    // 単独実行（基準）
+    std::vector<Outcome> solo;
+    for (const std::string& rom : roms) {
+        solo.push_back(runROM(rom));
+    }
+
+    // 全ROMを1スレッドずつ同時に
+    std::vector<Outcome> threaded(roms.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < roms.size(); ++i) {
+        threads.emplace_back([&, i] { threaded[i] = runROM(roms[i]); });
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    for (size_t i = 0; i < roms.size(); ++i) {
+        if (!solo[i].loaded || solo[i].frameHash != threaded[i].frameHash ||
+            solo[i].stateHash != threaded[i].stateHash) {
+            std::fprintf(stderr, "FAIL threaded %s: frame %016llx/%016llx state %016llx/%016llx\n",
+                         roms[i].c_str(),
+                         (unsigned long long)solo[i].frameHash, (unsigned long long)threaded[i].frameHash,
+                         (unsigned long long)solo[i].stateHash, (unsigned long long)threaded[i].stateHash);
+            ++failures;
+        }
+    }
+
+    // ファームを1スレッドと4スレッドで回し、ROMごとの結果を比べる
+    std::vector<FarmJob> jobs;
+    for (const std::string& rom : roms) {
+        FarmJob job;
+        job.romPath = rom;
+        job.options.maxFrames = FRAMES;
+        jobs.push_back(job);
+    }
+    const FarmReport single = runFarm(jobs, 1);
+    const FarmReport parallel = runFarm(jobs, 4);
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        const RunResult& a = single.results[i].run;
+        const RunResult& b = parallel.results[i].run;
+        if (a.frameHash != b.frameHash || a.cycles != b.cycles || a.serialOutput != b.serialOutput ||
+            single.results[i].status != parallel.results[i].status) {
+            std::fprintf(stderr, "FAIL farm %s: frame %016llx/%016llx cycles %llu/%llu\n",
+                         roms[i].c_str(), (unsigned long long)a.frameHash, (unsigned long long)b.frameHash,
+                         (unsigned long long)a.cycles, (unsigned long long)b.cycles);
+            ++failures;
+        }
+    }
+
+    if (failures) {
+        std::fprintf(stderr, "%d failures\n", failures);
+        return 1;
+    }
+    std::printf("parallel_test: %zu ROMs ok\n", roms.size());
+    return 0;
+}
@@ -0,0 +1,75 @@
+// RewindBuffer の押し込み/取り出しを小さなリングで交互に繰り返し、取り出した状態を全て照合する
+#include "rewind.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <vector>
+
+namespace {
+int failures = 0;
+
+void check(bool ok, const char* what, int step) {
+    if (!ok) {
+        if (failures < 10) std::fprintf(stderr, "FAIL step %d: %s\n", step, what);
+        ++failures;
+    }
+}
+
+// 容量・キーフレーム間隔・状態サイズを変えて1通り回す
+void run(size_t capacity, int keyframeInterval, size_t stateSize, uint32_t seed, int steps) {
+    RewindBuffer rewind(capacity, keyframeInterval);
+    std::deque<std::vector<uint8_t>> expected;  // 残っているはずの状態（古い順）
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> state(stateSize);
+    for (auto& b : state) b = static_cast<uint8_t>(rng());
+    std::vector<uint8_t> popped;
+
+    for (int step = 0; step < steps; ++step) {
+        // 巻き戻し→再開を模して、押し込み多めで時々まとめて取り出す
+        if (rng() % 4 == 0) {
+            int count = 1 + rng() % 12;
+            for (int i = 0; i < count; ++i) {
+                const bool ok = rewind.pop(popped);
+                check(ok == !expected.empty(), "pop result", step);
+                if (!ok) break;
+                check(popped == expected.back(), "restored state differs", step);
+                state = expected.back();  // 取り出した状態から続ける
+                expected.pop_back();
+            }
+            continue;
+        }
+        // 数バイトから全体まで、変化量をばらつかせる（差分の大きさが変わる）
+        const size_t changes = (rng() % 16 == 0) ? stateSize : 1 + rng() % 32;
+        for (size_t i = 0; i < changes; ++i) {
+            state[rng() % stateSize] = static_cast<uint8_t>(rng());
+        }
+        rewind.push(state);
+        expected.push_back(state);
+        // 追い出しは古い方からだけ起きる
+        check(rewind.size() <= expected.size(), "more entries than pushed", step);
+        while (expected.size() > rewind.size()) expected.pop_front();
+        check(rewind.bytesUsed() <= capacity, "bytes over capacity", step);
+    }
+    // 残りを全部取り出して照合
+    while (rewind.pop(popped)) {
+        check(!expected.empty() && popped == expected.back(), "final drain differs", steps);
+        if (!expected.empty()) expected.pop_back();
+    }
+    check(expected.empty(), "entries lost at drain", steps);
+}
+}
+
+int main() {
+    for (uint32_t seed = 1; seed <= 20; ++seed) {
+        run(4096, 8, 1000, seed, 5000);      // キーフレーム4つ分の小さなリング
+        run(2500, 4, 1000, seed, 5000);      // キーフレーム2つ分（折り返しのたびに追い出し）
+        run(64 * 1024, 60, 3000, seed, 3000);
+    }
+    if (failures) {
+        std::fprintf(stderr, "%d failures\n", failures);
+        return 1;
+    }
+    std::printf("rewind_test: ok\n");
+    return 0;
+}